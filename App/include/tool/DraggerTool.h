@@ -21,4 +21,6 @@ private:
 	int handleGrabbed;
 	Vector3 center;
 	Sphere handles[6];
+	// Where each selected part's look ray meets the mouse plane, this frame
+	Array<Sphere> markers;
 };
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include "V2DataModel/Part.h"
+
+class XplicitNgine;
+
+// Logs every call made into the engine, with the part state it reads, so a
+// play session can be run again headlessly by replayPhysics. One event per
+// line, starting with the event name, flushed as it's written so a crash
+// keeps everything up to it.
+class PhysicsRecorder
+{
+public:
+	PhysicsRecorder();
+	~PhysicsRecorder();
+	bool open(const std::string& filename);
+	void close();
+	bool isOpen();
+
+	// A new engine starts a new session, part ids start over
+	void recordEngine(XplicitNgine* engine);
+	void recordBroadphase(Enum::Broadphase::Value broadphase);
+	void recordThreadCount(int threads);
+	void recordQueue(PartInstance* partInstance);
+	void recordCreateQueued(const std::vector<PartInstance*>& parts);
+	void recordCreate(PartInstance* partInstance);
+	void recordDelete(PartInstance* partInstance);
+	void recordReset(PartInstance* partInstance);
+	void recordMove(PartInstance* partInstance);
+	void recordBegin();
+	void recordCommit();
+	void recordWeld(const std::vector<PartInstance*>& parts);
+	void recordGroupsCollide(int group1, int group2, bool collide);
+	void recordQuality(int level);
+	void recordAdvance(double dt, int steps);
+private:
+	int getId(PartInstance* partInstance);
+	void writeCFrame(const CoordinateFrame& cFrame);
+	void writeState(PartInstance* partInstance);
+
+	FILE* file;
+	std::map<PartInstance*, int> ids;
+};
+
+// Runs a recorded session on a fresh engine with no window. Writes a CSV row
+// for every frame that stepped: steps taken, time spent, awake bodies and a
+// checksum of every part's pose. Runs on one lane, whatever was recorded,
+// so the checksums repeat; threads above 0 asks for that many instead.
+// Returns false if the log can't be read.
+bool replayPhysics(const std::string& filename, FILE* csv, int threads);
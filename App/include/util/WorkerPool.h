@@ -0,0 +1,32 @@
+#pragma once
+#include <windows.h>
+#include <vector>
+
+// Fixed set of threads that run one batch of jobs at a time. The calling
+// thread works on the batch too, so a pool of n threads gives n+1 workers.
+class WorkerPool
+{
+public:
+	typedef void (*Job)(void* arg);
+
+	WorkerPool(int threadCount);
+	~WorkerPool(void);
+
+	int getThreadCount();
+	// Runs job(args[i]) for every i and returns once all of them are done
+	void run(Job job, void** args, int count);
+private:
+	static DWORD WINAPI threadProc(LPVOID param);
+	void work();
+
+	std::vector<HANDLE> threads;
+	std::vector<HANDLE> startEvents;
+	HANDLE doneEvent;
+	bool quitting;
+
+	Job job;
+	void** args;
+	int count;
+	volatile LONG nextIndex;
+	volatile LONG busyThreads;
+};
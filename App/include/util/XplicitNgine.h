@@ -2,19 +2,281 @@
 #include <ode/ode.h>
 #include "V2DataModel/Instance.h"
 #include "V2DataModel/Part.h"
+#include "Enum.h"
+#include "util/WorkerPool.h"
+#include <deque>
+
+class PhysicsRecorder;
+
+// State copied back from ODE for one awake body
+struct PhysTransform
+{
+	// Pose before the last step, for render interpolation
+	CoordinateFrame prevCFrame;
+	CoordinateFrame cFrame;
+	Vector3 velocity;
+	Vector3 rotVelocity;
+};
+
+// Where the engine's time went, in milliseconds, with the counts behind it.
+// Kept per step and per frame.
+struct PhysStats
+{
+	PhysStats();
+	int steps;
+	double broadphaseTime;
+	double narrowphaseTime;
+	// Islands, contact joints and the ODE step
+	double solverTime;
+	double syncTime;
+	double createTime;
+	double deleteTime;
+	// Bodies rebuilt by resets
+	double rebuildTime;
+	int pairs;
+	int contacts;
+	int awakeBodies;
+	int sleepingBodies;
+	int bodiesCreated;
+	int bodiesDeleted;
+	// Where the quality governor had the solver
+	int qualityLevel;
+	int solverIterations;
+	int contactsPerPair;
+};
+
+// Lets AABSPTree hold geoms directly
+inline void getBounds(const dGeomID& geom, G3D::AABox& out)
+{
+	dReal aabb[6];
+	dGeomGetAABB(geom, aabb);
+	out = G3D::AABox(G3D::Vector3(aabb[0], aabb[2], aabb[4]), G3D::Vector3(aabb[1], aabb[3], aabb[5]));
+}
 
 class XplicitNgine : public Instance
 {
 public:
 	XplicitNgine();
 	~XplicitNgine();
+	// First lane's world, space and contact group
 	dWorldID physWorld;
 	dSpaceID physSpace;
 	dJointGroupID contactgroup;
 
 	void step(float stepSize);
+	void setBroadphase(Enum::Broadphase::Value broadphase);
+	Enum::Broadphase::Value getBroadphase();
+	// Splits the bodies over this many worlds, solved at the same time.
+	// Opt-in: ODE 0.6's quickstep reorders constraints with one global
+	// random seed, so with more than one lane the result can differ from
+	// run to run. Only takes effect while the engine has no bodies.
+	void setThreadCount(int threads);
+	int getThreadCount();
+	// Called by the broadphase for each pair worth a dCollide
+	void addPair(dGeomID o1, dGeomID o2);
+
+	// Fixed-step clock
+	float fixedStepSize;
+	int maxCatchUpSteps;
+	float timeScale;
+	int advance(double dt);
+	void interpolate();
+
+	// Quality governor. While stepBudget (milliseconds of physics per frame)
+	// is above 0, advance() drops solver iterations and contacts per pair to
+	// stay inside it, and raises them again once there's room. Each is kept
+	// between its limits below. Off by default. Cutting steps per frame
+	// slows the simulation below real time, so the governor only does that
+	// too when governSteps is set.
+	static const int qualityLevels = 5;
+	float stepBudget;
+	bool governSteps;
+	int minIterations;
+	int maxIterations;
+	int minContacts;
+	int maxContacts;
+	int minStepsPerFrame;
+	// 0 is the cheapest, qualityLevels - 1 is full quality
+	void setQualityLevel(int level);
+	int getQualityLevel();
+
+	// Box pairs that both line up with the world axes get their contacts
+	// from a cheap overlap test instead of dBoxBox. Rotated boxes, and
+	// everything else, still go through dCollide.
+	bool alignedBoxContacts;
 	void createBody(PartInstance* partInstance);
 	void deleteBody(PartInstance* partInstance);
 	void updateBody(PartInstance* partInstance);
 	void resetBody(PartInstance* partInstance);
-};
\ No newline at end of file
+
+	// Batch edits: resets and deletes between begin and commit are applied in
+	// one pass at commit, and neighbours are woken once. Batches can nest.
+	void beginMutations();
+	void commitMutations();
+
+	// Welds parts glued by a Bumps face into one body per assembly. Groups
+	// holding an anchored part are held still without bodies. Editing a
+	// member breaks its assembly up again.
+	void buildAssemblies(const std::vector<PartInstance*>& parts);
+
+	// Collision groups, 0 to 31. Every pair of groups collides until told
+	// otherwise. Filtered pairs, and parts with canCollide off, are dropped
+	// in the broadphase before any dCollide.
+	void setGroupsCollide(int group1, int group2, bool collide);
+	bool getGroupsCollide(int group1, int group2);
+
+	// Active set
+	void queueBody(PartInstance* partInstance);
+	void createQueuedBodies();
+	void wakeBody(dBodyID body);
+	void syncBodies();
+	const std::vector<PartInstance*>& getActiveParts();
+
+	// Profiling. A frame is everything since the previous advance().
+	const PhysStats& getStepStats();
+	const PhysStats& getFrameStats();
+	// Writes the recent frames as CSV or JSON
+	bool dumpStats(const std::string& filename, bool json);
+private:
+	void finishFrame(int steps);
+	int qualityValue(int low, int high);
+	void applyQuality();
+	void governQuality(double frameTime);
+
+	// What the public calls do once they've been recorded
+	void addBody(PartInstance* partInstance);
+	void removeBody(PartInstance* partInstance);
+	void placeBody(PartInstance* partInstance);
+	void closeBatch();
+	void undirtyBody(PartInstance* partInstance);
+	void applyMutations();
+	void refreshBody(PartInstance* partInstance);
+	void applyCollisionBits(PartInstance* partInstance);
+	void createPhysBody(PartInstance* partInstance);
+	void destroyPhysBody(PartInstance* partInstance);
+	// Keeps draggedBodies in step with the part's physDragged
+	void setDragged(PartInstance* partInstance, bool dragged);
+	void addStatic(dGeomID geom);
+	void removeStatic(dGeomID geom);
+	void collideStatic();
+	void collideStaticGeom(dGeomID geom);
+	void weldAssembly(const std::vector<PartInstance*>& parts);
+	void dissolveAssembly(PartInstance* root, PartInstance* leaving);
+	void attachGeom(PartInstance* partInstance, dBodyID body);
+	void syncAssembly(PartInstance* root, const PhysTransform& transform);
+	void touchGeom(dGeomID geom);
+	void wakeTouching(dGeomID geom);
+	void flushWakes();
+
+	// A world stepped on its own thread. Every body in an island has to share
+	// a lane since contact joints can't cross worlds. Each lane's geoms sit in
+	// its own space, which ODE relinks as the lane's bodies move.
+	struct Lane
+	{
+		dWorldID world;
+		dSpaceID space;
+		dJointGroupID contactGroup;
+		int bodyCount;
+		float stepSize;
+	};
+	static void stepLane(void* arg);
+	void createLanes(int count);
+	void destroyLanes();
+	int pickLane();
+	void setGeomLane(dGeomID geom, int lane);
+	void moveBody(PartInstance* partInstance, int lane);
+	int islandIndex(dBodyID body);
+	void gatherIslands();
+	void countIdleSteps();
+	void createContactJoints();
+	void stepLanes(float stepSize);
+
+	struct GeomPair
+	{
+		dGeomID o1;
+		dGeomID o2;
+	};
+	// A slice of the candidate pairs and the contacts found in it
+	struct NarrowphaseBatch
+	{
+		const GeomPair* pairs;
+		int count;
+		int maxContacts;
+		bool alignedBoxes;
+		std::vector<dContact> contacts;
+	};
+	static void collideBatch(void* arg);
+	void narrowphase();
+
+	// One geom's bounds for the sweep-and-prune broadphase
+	struct SweepEntry
+	{
+		dGeomID geom;
+		int lane;
+		dReal aabb[6];
+	};
+	static dSpaceID createSpace(Enum::Broadphase::Value broadphase);
+	void collide();
+	// acrossLanes skips pairs whose geoms share a lane
+	void sweepAndPrune(bool acrossLanes);
+	void capturePrevious();
+	void addActive(PartInstance* partInstance);
+	void removeActive(PartInstance* partInstance);
+	void dequeueBody(PartInstance* partInstance);
+
+	// Awake, non-anchored parts; activeTransforms is indexed the same way
+	std::vector<PartInstance*> activeParts;
+	std::vector<PhysTransform> activeTransforms;
+	// Parts waiting for a body, created on the next running frame
+	std::vector<PartInstance*> queuedParts;
+	// Simulated time not yet consumed by a whole step
+	double accumulator;
+	int qualityLevel;
+	int solverIterations;
+	int contactsPerPair;
+	// Physics time per frame, smoothed, and frames since the level moved
+	double governedTime;
+	int governedFrames;
+	Enum::Broadphase::Value broadphase;
+	// Kept between steps so the sweep doesn't reallocate
+	std::vector<SweepEntry> sweepEntries;
+
+	// Logs calls into the engine while a session is being recorded
+	PhysicsRecorder* recorder;
+
+	int mutationDepth;
+	std::vector<PartInstance*> dirtyParts;
+	// Geoms that moved or changed, and geoms of deleted bodies, waiting to
+	// wake whatever they touch
+	std::vector<dGeomID> touchedGeoms;
+	std::vector<dGeomID> retiredGeoms;
+
+	// Collide bits for each group, bit n set if it touches group n
+	unsigned long groupMasks[32];
+
+	// Anchored and dragged geoms. They sit in no ODE space, our ODE's
+	// dSpaceCollide2 is a linear scan, so awake bodies query this instead.
+	// Geoms that can't collide are left out.
+	AABSPTree<dGeomID> staticTree;
+	Array<dGeomID> staticHits;
+	int staticEdits;
+
+	PhysStats stepStats;
+	PhysStats frameStats;
+	// The frame still being counted
+	PhysStats pendingStats;
+	std::deque<PhysStats> statsHistory;
+
+	std::vector<Lane> lanes;
+	// Bodies parked under a dragged part, neither awake nor asleep
+	int draggedBodies;
+	WorkerPool* workerPool;
+	std::vector<GeomPair> candidatePairs;
+	std::vector<NarrowphaseBatch> narrowphaseBatches;
+	// Contacts found this step, turned into joints once islands are settled
+	std::vector<dContact> pendingContacts;
+	// Bodies being sorted into islands, active parts first, and each one's
+	// parent in the union
+	std::vector<PartInstance*> islandParts;
+	std::vector<int> islandParents;
+};
@@ -50,7 +50,11 @@ public:
 	void					toggleRun();
 	bool					isRunning();
 	void					resetEngine();
-	bool					scanXMLObject(rapidxml::xml_node<>* node);
+	// Quality governor budget in milliseconds, 0 for off. Kept for every
+	// engine resetEngine makes.
+	void					setPhysicsBudget(float budget);
+	// collisionGroup is a surrounding model's group, -1 outside any model
+	bool					scanXMLObject(rapidxml::xml_node<>* node, int collisionGroup = -1);
 #if _DEBUG
 	void					modXMLLevel(float modY);
 #endif
@@ -58,10 +62,16 @@ private:
 	bool isBrickCount;
 	rapidxml::xml_node<>*	getNode(rapidxml::xml_node<> * node,const char* name );
 	float					getFloatValue(rapidxml::xml_node<> * node,const char* name);
+	rapidxml::xml_node<>*	getProperty(rapidxml::xml_node<> * itemNode,const char* name);
+	void					loadCollisionGroups(const char* groups);
 	bool					_successfulLoad;
 	std::string				_errMsg;
 	bool					_legacyLoad;
 	float					_modY;
+	// The level's collision group matrix, bit n of each set if it touches
+	// group n. Handed to every engine resetEngine makes.
+	unsigned long			groupMasks[32];
+	float					physicsBudget;
 	
 	// Instances
 	WorkspaceInstance*		workspace;
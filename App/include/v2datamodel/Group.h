@@ -11,6 +11,16 @@ public:
 	virtual std::vector<PROPGRIDITEM> getProperties();
 	virtual void PropUpdate(LPPROPGRIDITEM &pItem);
 	std::vector<Instance *> unGroup();
+	void setParent(Instance* parent);
 	PartInstance * primaryPart;
+	// Workspace the model is in, which draws its flag
+	WorkspaceInstance* renderWorkspace;
+	// Puts every part in the model in one collision group
+	void setCollisionGroup(int group);
+	int getCollisionGroup();
 	void render(RenderDevice * r);
+	// The controller flag over primaryPart
+	void renderFlag(RenderDevice * r);
+private:
+	int collisionGroup;
 };
@@ -19,8 +19,12 @@ public:
 	bool					mouseInGUI(G3D::RenderDevice* renderDevice,int x,int y);
 	void					onMouseLeftUp(G3D::RenderDevice* renderDevice, int x,int y);
 	void					hideGui(bool doHide);
+	void					showPhysicsStats(bool doShow);
+	bool					isShowingPhysicsStats();
 private:
+	void					drawPhysicsStats(G3D::RenderDevice* rd);
 	std::string			_message;
 	G3D::RealTime		_messageTime;
 	bool				_hideGui;
+	bool				_showPhysicsStats;
 };
\ No newline at end of file
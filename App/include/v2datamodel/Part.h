@@ -1,9 +1,12 @@
 #pragma once
 #include "PVInstance.h"
 #include "Enum.h"
+#include "MeshCache.h"
 #define _USE_MATH_DEFINES
 #include <cmath>
 
+class WorkspaceInstance;
+
 class PartInstance : public PVInstance
 {
 public:
@@ -16,7 +19,9 @@ public:
 	//Rendering
 	virtual void PartInstance::postRender(RenderDevice* rd);
 	virtual void render(RenderDevice*);
-	virtual void renderName(RenderDevice*);
+	// Shared display list for the part's mesh, looked up again after edits.
+	// Draws with no colour or material of its own.
+	GLuint getMeshList();
 
 	//Surfaces
 	Enum::SurfaceType::Value top;
@@ -36,8 +41,45 @@ public:
 	//Variables
 	Color3 color;
 	bool canCollide;
+	// 0 to 31, the engine decides which groups touch
+	int collisionGroup;
 	dBodyID physBody;
 	dGeomID physGeom[3];
+	// Slot in the engine's active set, -1 while asleep or bodiless
+	int physActiveIndex;
+	bool physQueued;
+	// Waiting for a rebuild in the engine's current mutation batch
+	bool physDirty;
+	// Which engine world holds physBody
+	int physLane;
+	// Steps physBody has been slow enough to fall asleep, kept while awake
+	int physIdleSteps;
+	// physBody is parked, disabled, while the part is dragged
+	bool physDragged;
+	// Welded assembly: every member points at the root, which owns the shared
+	// body (or is the anchored part holding the group still) and lists the rest
+	PartInstance* physRoot;
+	std::vector<PartInstance*> physWelded;
+	// This part's pose relative to the assembly's body
+	CoordinateFrame physOffset;
+	// Moved or resized since the workspace last placed it in its part tree
+	bool boundsChanged;
+	// Slot in the workspace's moving parts, -1 while it rests in the part
+	// tree, and frames since it last moved
+	int renderMovingIndex;
+	int renderStillFrames;
+	// Level of detail the brick renderer drew it at last frame
+	int renderTier;
+	// Static chunk the part is baked into, -1 if none, and whether it changed
+	// in a way the chunk has to be rebuilt for
+	int renderChunk;
+	bool bakeChanged;
+	// Workspace the part is in, told when it changes, and whether it's on
+	// that workspace's list of changed parts
+	WorkspaceInstance* renderWorkspace;
+	bool renderQueued;
+	void markBoundsChanged();
+	void markBakeChanged();
 
 	//Getters
 	Vector3 getPosition();
@@ -48,6 +90,7 @@ public:
 	Sphere getSphere();
 	Box getScaledBox();
 	CoordinateFrame getCFrame();
+	CoordinateFrame getRenderCFrame();
 
 	//OnTouch Getters
 	bool isSingleShot();
@@ -63,12 +106,15 @@ public:
 	void setRotVelocity(Vector3);
 	void setCFrame(CoordinateFrame);
 	void setCFrameNoSync(CoordinateFrame);
+	void setRenderCFrame(CoordinateFrame);
 	void setSize(Vector3);
 	void setShape(Enum::Shape::Value shape);
 	void setChanged();
 	void setSurface(int face, Enum::SurfaceType::Value surface);
 	void setAnchored(bool anchored);
 	bool isAnchored();
+	void setCanCollide(bool canCollide);
+	void setCollisionGroup(int group);
 	float getMass();
 	bool isDragging();
 	void setDragging(bool value);
@@ -91,8 +137,12 @@ private:
 	Vector3 rotVelocity;
 	bool changed;
 	bool dragging;
+	// Where the part is drawn, lags cFrame by up to one physics step
+	CoordinateFrame renderCFrame;
 	Box itemBox;
+	// Shared list from the mesh cache, and the key it was taken under
 	GLuint glList;
+	MeshKey meshKey;
 
 	// OnTouch
 	bool singleShot;
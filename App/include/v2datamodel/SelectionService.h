@@ -2,6 +2,8 @@
 #include "Instance.h"
 #include "PropertyWindow.h"
 
+class SelectionRenderer;
+
 class SelectionService : public Instance
 {
 public:
@@ -15,8 +17,15 @@ public:
 	void removeSelected(Instance * instance);
 	void addSelected(const std::vector<Instance *> &instances);
 	void setPropertyWindow(PropertyWindow * propertyWindow);
+	// Outlines and handles come from a buffer that's only rebuilt when the
+	// selection or a selected part changes
 	void render(RenderDevice * rd);
+	SelectionRenderer* getSelectionRenderer();
+	// Goes up every time the selection changes
+	int getVersion();
 private:
 	std::vector<Instance *> selection;
 	PropertyWindow * propertyWindow;
+	SelectionRenderer* selectionRenderer;
+	int version;
 };
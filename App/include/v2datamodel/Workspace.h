@@ -2,6 +2,18 @@
 #include "Group.h"
 #include "Part.h"
 
+class BrickRenderer;
+class LabelRenderer;
+
+// Lets AABSPTree hold parts, padded to take in studs
+inline void getBounds(PartInstance* const& part, G3D::AABox& out)
+{
+	Vector3 half = part->getSize() / 2;
+	AABox bounds;
+	part->getRenderCFrame().toWorldSpace(Box(-half, half)).getBounds(bounds);
+	out = AABox(bounds.low() - Vector3(0.2F, 0.2F, 0.2F), bounds.high() + Vector3(0.2F, 0.2F, 0.2F));
+}
+
 class WorkspaceInstance :
 	public GroupInstance
 {
@@ -10,5 +22,48 @@ public:
 	~WorkspaceInstance(void);
 	void clearChildren();
 	void zoomToExtents();
+	// Parts go through the brick renderer, groups only draw their flags
+	void render(RenderDevice * rd);
+	// Every shown name in one pass, after render
+	void renderName(RenderDevice * rd);
+	BrickRenderer* getBrickRenderer();
+	LabelRenderer* getLabelRenderer();
 	std::vector<PartInstance *> partObjects;
+	void addPart(PartInstance* part);
+	void removePart(PartInstance* part);
+	// Models whose flags are drawn, kept by GroupInstance::setParent
+	void addGroup(GroupInstance* group);
+	void removeGroup(GroupInstance* group);
+	// Called by a part the first time it changes each frame
+	void queueChanged(PartInstance* part);
+	// Off hands every part to the renderer, for comparison
+	void setCulling(bool culling);
+	bool isCulling();
+	// Parts sent to the renderer and parts left out by the frustum last frame
+	int getSubmittedParts();
+	int getCulledParts();
+private:
+	void updatePartTree();
+	void detachParts();
+	void addMoving(PartInstance* part);
+	void removeMoving(PartInstance* part);
+	BrickRenderer* brickRenderer;
+	LabelRenderer* labelRenderer;
+	// Parts that changed since the last frame, so the upkeep doesn't have to
+	// look at the rest
+	std::vector<PartInstance*> changedParts;
+	// Resting parts by their bounds, rebalanced once enough of it has changed.
+	// A part that moves is taken out and culled on its own until it has been
+	// still for a while, so a running simulation doesn't edit the tree every
+	// frame.
+	AABSPTree<PartInstance*> partTree;
+	int partTreeEdits;
+	std::vector<PartInstance*> movingParts;
+	std::vector<GroupInstance*> groupObjects;
+	bool culling;
+	Array<Plane> clipPlanes;
+	Array<PartInstance*> visibleMembers;
+	std::vector<PartInstance*> visibleParts;
+	int submittedParts;
+	int culledParts;
 };
@@ -3,6 +3,7 @@
 #include "Tool/DraggerTool.h"
 #include "Application.h"
 #include "V2DataModel/SelectionService.h"
+#include "SelectionRenderer.h"
 
 DraggerTool::DraggerTool(void)
 {
@@ -114,7 +115,9 @@ void DraggerTool::render(RenderDevice * rd, Mouse mouse)
 			G3D::Draw::arrow(center, handles[i].center-center, rd, Color3::orange(), 2);
 		}
 	}
-	std::vector<Instance *> selection = g_dataModel->getSelectionService()->getSelection();
+	SelectionService* selectionService = g_dataModel->getSelectionService();
+	std::vector<Instance *> selection = selectionService->getSelection();
+	markers.fastClear();
 	for(size_t i = 0; i < selection.size(); i++)
 	{
 		if(PartInstance* part = dynamic_cast<PartInstance*>(selection[i]))
@@ -124,12 +127,13 @@ void DraggerTool::render(RenderDevice * rd, Mouse mouse)
 			Vector3 intersection2 = ray.intersection(mouse.getInversePlane());
 			if(intersection1.isFinite())
 			{
-				Draw::sphere(Sphere(intersection1, 2), rd);
+				markers.append(Sphere(intersection1, 2));
 			}
 			else if(intersection2.isFinite())
 			{
-				Draw::sphere(Sphere(intersection2, 2), rd);
+				markers.append(Sphere(intersection2, 2));
 			}
 		}
 	}
+	selectionService->getSelectionRenderer()->renderMarkers(rd, markers, Color4(1, 1, 0, 0.5F));
 }
\ No newline at end of file
@@ -0,0 +1,418 @@
+#include "util/stdafx.h"
+
+#include "Util/PhysicsRecorder.h"
+#include "Util/XplicitNgine.h"
+#include "Globals.h"
+#include "Faces.h"
+#include <fstream>
+#include <sstream>
+
+PhysicsRecorder::PhysicsRecorder()
+{
+	file = NULL;
+}
+
+PhysicsRecorder::~PhysicsRecorder()
+{
+	close();
+}
+
+bool PhysicsRecorder::open(const std::string& filename)
+{
+	close();
+	file = fopen(filename.c_str(), "w");
+	return file != NULL;
+}
+
+void PhysicsRecorder::close()
+{
+	if(file != NULL)
+	{
+		fclose(file);
+		file = NULL;
+	}
+	ids.clear();
+}
+
+bool PhysicsRecorder::isOpen()
+{
+	return file != NULL;
+}
+
+int PhysicsRecorder::getId(PartInstance* partInstance)
+{
+	std::map<PartInstance*, int>::iterator it = ids.find(partInstance);
+	if(it != ids.end())
+		return it->second;
+	int id = (int)ids.size();
+	ids[partInstance] = id;
+	return id;
+}
+
+void PhysicsRecorder::writeCFrame(const CoordinateFrame& cFrame)
+{
+	// 9 digits round-trips a float, so the replay starts from the same bits
+	for(int i = 0; i < 3; i++)
+		fprintf(file, " %.9g %.9g %.9g", cFrame.rotation[i][0], cFrame.rotation[i][1], cFrame.rotation[i][2]);
+	fprintf(file, " %.9g %.9g %.9g", cFrame.translation.x, cFrame.translation.y, cFrame.translation.z);
+}
+
+void PhysicsRecorder::writeState(PartInstance* partInstance)
+{
+	Vector3 size = partInstance->getSize();
+	Vector3 velocity = partInstance->getVelocity();
+	Vector3 rotVelocity = partInstance->getRotVelocity();
+	fprintf(file, " %d %d %d %.9g %.9g %.9g", (int)partInstance->shape, partInstance->isAnchored() ? 1 : 0, partInstance->isDragging() ? 1 : 0, size.x, size.y, size.z);
+	writeCFrame(partInstance->getCFrame());
+	fprintf(file, " %.9g %.9g %.9g %.9g %.9g %.9g", velocity.x, velocity.y, velocity.z, rotVelocity.x, rotVelocity.y, rotVelocity.z);
+	fprintf(file, " %d %d %d %d %d %d", (int)partInstance->top, (int)partInstance->bottom, (int)partInstance->left, (int)partInstance->right, (int)partInstance->front, (int)partInstance->back);
+	fprintf(file, " %d %d", partInstance->canCollide ? 1 : 0, partInstance->collisionGroup);
+}
+
+void PhysicsRecorder::recordEngine(XplicitNgine* engine)
+{
+	ids.clear();
+	fprintf(file, "engine %d %d %.9g %d %.9g\n", (int)engine->getBroadphase(), engine->getThreadCount(), engine->fixedStepSize, engine->maxCatchUpSteps, engine->timeScale);
+	fflush(file);
+}
+
+void PhysicsRecorder::recordBroadphase(Enum::Broadphase::Value broadphase)
+{
+	fprintf(file, "broadphase %d\n", (int)broadphase);
+	fflush(file);
+}
+
+void PhysicsRecorder::recordThreadCount(int threads)
+{
+	fprintf(file, "threads %d\n", threads);
+	fflush(file);
+}
+
+void PhysicsRecorder::recordQueue(PartInstance* partInstance)
+{
+	fprintf(file, "queue %d\n", getId(partInstance));
+	fflush(file);
+}
+
+void PhysicsRecorder::recordCreateQueued(const std::vector<PartInstance*>& parts)
+{
+	// Queued parts are usually set up after they're queued, so their state is
+	// taken here, right before the engine reads it
+	for(size_t i = 0; i < parts.size(); i++)
+	{
+		fprintf(file, "state %d", getId(parts[i]));
+		writeState(parts[i]);
+		fprintf(file, "\n");
+	}
+	fprintf(file, "createQueued\n");
+	fflush(file);
+}
+
+void PhysicsRecorder::recordCreate(PartInstance* partInstance)
+{
+	fprintf(file, "create %d", getId(partInstance));
+	writeState(partInstance);
+	fprintf(file, "\n");
+	fflush(file);
+}
+
+void PhysicsRecorder::recordDelete(PartInstance* partInstance)
+{
+	fprintf(file, "delete %d\n", getId(partInstance));
+	fflush(file);
+}
+
+void PhysicsRecorder::recordReset(PartInstance* partInstance)
+{
+	fprintf(file, "reset %d", getId(partInstance));
+	writeState(partInstance);
+	fprintf(file, "\n");
+	fflush(file);
+}
+
+void PhysicsRecorder::recordMove(PartInstance* partInstance)
+{
+	fprintf(file, "move %d", getId(partInstance));
+	writeCFrame(partInstance->getCFrame());
+	fprintf(file, "\n");
+	fflush(file);
+}
+
+void PhysicsRecorder::recordGroupsCollide(int group1, int group2, bool collide)
+{
+	fprintf(file, "groups %d %d %d\n", group1, group2, collide ? 1 : 0);
+	fflush(file);
+}
+
+void PhysicsRecorder::recordQuality(int level)
+{
+	fprintf(file, "quality %d\n", level);
+	fflush(file);
+}
+
+void PhysicsRecorder::recordBegin()
+{
+	fprintf(file, "begin\n");
+	fflush(file);
+}
+
+void PhysicsRecorder::recordCommit()
+{
+	fprintf(file, "commit\n");
+	fflush(file);
+}
+
+void PhysicsRecorder::recordWeld(const std::vector<PartInstance*>& parts)
+{
+	fprintf(file, "weld %u", (unsigned int)parts.size());
+	for(size_t i = 0; i < parts.size(); i++)
+		fprintf(file, " %d", getId(parts[i]));
+	fprintf(file, "\n");
+	fflush(file);
+}
+
+void PhysicsRecorder::recordAdvance(double dt, int steps)
+{
+	fprintf(file, "advance %.17g %d\n", dt, steps);
+	fflush(file);
+}
+
+namespace
+{
+	CoordinateFrame readCFrame(std::istream& in)
+	{
+		Matrix3 rotation;
+		Vector3 translation;
+		for(int i = 0; i < 3; i++)
+			in >> rotation[i][0] >> rotation[i][1] >> rotation[i][2];
+		in >> translation.x >> translation.y >> translation.z;
+		return CoordinateFrame(rotation, translation);
+	}
+
+	void readState(std::istream& in, PartInstance* partInstance)
+	{
+		int shape, anchored, dragging;
+		Vector3 size, velocity, rotVelocity;
+		int surfaces[6];
+		in >> shape >> anchored >> dragging >> size.x >> size.y >> size.z;
+		CoordinateFrame cFrame = readCFrame(in);
+		in >> velocity.x >> velocity.y >> velocity.z >> rotVelocity.x >> rotVelocity.y >> rotVelocity.z;
+		for(int i = 0; i < 6; i++)
+			in >> surfaces[i];
+		int canCollide = 1, collisionGroup = 0;
+		in >> canCollide >> collisionGroup;
+
+		partInstance->setShape((Enum::Shape::Value)shape);
+		partInstance->setSize(size);
+		partInstance->setAnchored(anchored != 0);
+		partInstance->setDragging(dragging != 0);
+		partInstance->setCFrameNoSync(cFrame);
+		partInstance->setVelocity(velocity);
+		partInstance->setRotVelocity(rotVelocity);
+		partInstance->setSurface(TOP, (Enum::SurfaceType::Value)surfaces[0]);
+		partInstance->setSurface(BOTTOM, (Enum::SurfaceType::Value)surfaces[1]);
+		partInstance->setSurface(LEFT, (Enum::SurfaceType::Value)surfaces[2]);
+		partInstance->setSurface(RIGHT, (Enum::SurfaceType::Value)surfaces[3]);
+		partInstance->setSurface(FRONT, (Enum::SurfaceType::Value)surfaces[4]);
+		partInstance->setSurface(BACK, (Enum::SurfaceType::Value)surfaces[5]);
+		partInstance->setCanCollide(canCollide != 0);
+		partInstance->setCollisionGroup(collisionGroup);
+	}
+
+	PartInstance* getPart(std::map<int, PartInstance*>& parts, int id)
+	{
+		std::map<int, PartInstance*>::iterator it = parts.find(id);
+		if(it != parts.end())
+			return it->second;
+		PartInstance* partInstance = new PartInstance();
+		parts[id] = partInstance;
+		return partInstance;
+	}
+
+	// FNV-1a over the pose of every part with physics, in id order
+	unsigned int checksum(const std::map<int, PartInstance*>& parts)
+	{
+		unsigned int hash = 2166136261U;
+		for(std::map<int, PartInstance*>::const_iterator it = parts.begin(); it != parts.end(); ++it)
+		{
+			if(it->second->physGeom[0] == NULL)
+				continue;
+			CoordinateFrame cFrame = it->second->getCFrame();
+			float values[12];
+			for(int i = 0; i < 3; i++)
+			{
+				values[i*3] = cFrame.rotation[i][0];
+				values[i*3+1] = cFrame.rotation[i][1];
+				values[i*3+2] = cFrame.rotation[i][2];
+			}
+			values[9] = cFrame.translation.x;
+			values[10] = cFrame.translation.y;
+			values[11] = cFrame.translation.z;
+
+			const unsigned char* bytes = (const unsigned char*)values;
+			for(size_t i = 0; i < sizeof(values); i++)
+			{
+				hash ^= bytes[i];
+				hash *= 16777619U;
+			}
+		}
+		return hash;
+	}
+
+	void endSession(XplicitNgine*& engine, std::map<int, PartInstance*>& parts)
+	{
+		for(std::map<int, PartInstance*>::iterator it = parts.begin(); it != parts.end(); ++it)
+			delete it->second;
+		parts.clear();
+		g_xplicitNgine = NULL;
+		delete engine;
+		engine = NULL;
+	}
+}
+
+bool replayPhysics(const std::string& filename, FILE* csv, int threads)
+{
+	std::ifstream log(filename.c_str());
+	if(!log)
+		return false;
+
+	// The replay mustn't end up in a log of its own
+	PhysicsRecorder* recorder = g_physicsRecorder;
+	g_physicsRecorder = NULL;
+
+	XplicitNgine* engine = NULL;
+	std::map<int, PartInstance*> parts;
+	int frame = 0;
+	fprintf(csv, "frame,steps,ms,broadphase_ms,narrowphase_ms,solver_ms,pairs,contacts,active,checksum\n");
+
+	std::string line;
+	while(std::getline(log, line))
+	{
+		std::istringstream in(line);
+		std::string event;
+		int id = 0;
+		in >> event;
+
+		if(event == "engine")
+		{
+			endSession(engine, parts);
+			int broadphase, recordedThreads;
+			in >> broadphase >> recordedThreads;
+			engine = new XplicitNgine();
+			g_xplicitNgine = engine;
+			in >> engine->fixedStepSize >> engine->maxCatchUpSteps >> engine->timeScale;
+			// More than one lane races on ODE's global random seed, so the
+			// checksums only repeat on one unless asked otherwise
+			engine->setThreadCount(threads > 0 ? threads : 1);
+			engine->setBroadphase((Enum::Broadphase::Value)broadphase);
+			// The governor reacts to this machine's timings, follow the
+			// recorded quality changes instead
+			engine->stepBudget = 0;
+			// The solver shuffles constraints with ODE's global generator
+			dRandSetSeed(0);
+			continue;
+		}
+		if(engine == NULL)
+			continue;
+
+		if(event == "broadphase")
+		{
+			int broadphase;
+			in >> broadphase;
+			engine->setBroadphase((Enum::Broadphase::Value)broadphase);
+		}
+		else if(event == "threads")
+		{
+			// The replay keeps the lane count it picked above
+		}
+		else if(event == "queue")
+		{
+			in >> id;
+			engine->queueBody(getPart(parts, id));
+		}
+		else if(event == "state")
+		{
+			in >> id;
+			readState(in, getPart(parts, id));
+		}
+		else if(event == "createQueued")
+			engine->createQueuedBodies();
+		else if(event == "create")
+		{
+			in >> id;
+			PartInstance* partInstance = getPart(parts, id);
+			readState(in, partInstance);
+			engine->createBody(partInstance);
+		}
+		else if(event == "delete")
+		{
+			in >> id;
+			engine->deleteBody(getPart(parts, id));
+		}
+		else if(event == "reset")
+		{
+			// The setters each ask for a reset, the batch makes that one rebuild
+			in >> id;
+			PartInstance* partInstance = getPart(parts, id);
+			engine->beginMutations();
+			readState(in, partInstance);
+			engine->resetBody(partInstance);
+			engine->commitMutations();
+		}
+		else if(event == "move")
+		{
+			in >> id;
+			PartInstance* partInstance = getPart(parts, id);
+			partInstance->setCFrameNoSync(readCFrame(in));
+			engine->updateBody(partInstance);
+		}
+		else if(event == "begin")
+			engine->beginMutations();
+		else if(event == "commit")
+			engine->commitMutations();
+		else if(event == "weld")
+		{
+			unsigned int count = 0;
+			in >> count;
+			std::vector<PartInstance*> welded;
+			for(unsigned int i = 0; i < count; i++)
+			{
+				in >> id;
+				welded.push_back(getPart(parts, id));
+			}
+			engine->buildAssemblies(welded);
+		}
+		else if(event == "quality")
+		{
+			int level = 0;
+			in >> level;
+			engine->setQualityLevel(level);
+		}
+		else if(event == "groups")
+		{
+			int group1 = 0, group2 = 0, collide = 1;
+			in >> group1 >> group2 >> collide;
+			engine->setGroupsCollide(group1, group2, collide != 0);
+		}
+		else if(event == "advance")
+		{
+			double dt = 0;
+			in >> dt;
+			RealTime start = System::time();
+			int steps = engine->advance(dt);
+			RealTime elapsed = System::time() - start;
+			if(steps > 0)
+			{
+				const PhysStats& stats = engine->getFrameStats();
+				fprintf(csv, "%d,%d,%.3f,%.3f,%.3f,%.3f,%d,%d,%u,%08x\n", frame, steps, elapsed * 1000.0,
+					stats.broadphaseTime, stats.narrowphaseTime, stats.solverTime, stats.pairs, stats.contacts,
+					(unsigned int)engine->getActiveParts().size(), checksum(parts));
+			}
+			frame++;
+		}
+	}
+
+	endSession(engine, parts);
+	g_physicsRecorder = recorder;
+	return true;
+}
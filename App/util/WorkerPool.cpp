@@ -0,0 +1,118 @@
+#include "util/stdafx.h"
+
+#include "util/WorkerPool.h"
+
+// ODE solves islands with alloca, so workers get the same stack as the main thread
+#define WORKER_STACK_SIZE 16777216
+
+struct WorkerStart
+{
+	WorkerPool* pool;
+	HANDLE startEvent;
+};
+
+WorkerPool::WorkerPool(int threadCount)
+{
+	quitting = false;
+	job = NULL;
+	args = NULL;
+	count = 0;
+	nextIndex = 0;
+	busyThreads = 0;
+	doneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	for(int i = 0; i < threadCount; i++)
+	{
+		HANDLE startEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+		WorkerStart* start = new WorkerStart();
+		start->pool = this;
+		start->startEvent = startEvent;
+		HANDLE thread = CreateThread(NULL, WORKER_STACK_SIZE, &WorkerPool::threadProc, start, STACK_SIZE_PARAM_IS_A_RESERVATION, NULL);
+		if(thread == NULL)
+		{
+			delete start;
+			CloseHandle(startEvent);
+			break;
+		}
+		startEvents.push_back(startEvent);
+		threads.push_back(thread);
+	}
+}
+
+WorkerPool::~WorkerPool(void)
+{
+	quitting = true;
+	for(size_t i = 0; i < startEvents.size(); i++)
+		SetEvent(startEvents[i]);
+	if(threads.size() > 0)
+		WaitForMultipleObjects((DWORD)threads.size(), &threads[0], TRUE, INFINITE);
+	for(size_t i = 0; i < threads.size(); i++)
+	{
+		CloseHandle(threads[i]);
+		CloseHandle(startEvents[i]);
+	}
+	CloseHandle(doneEvent);
+}
+
+int WorkerPool::getThreadCount()
+{
+	return (int)threads.size();
+}
+
+DWORD WINAPI WorkerPool::threadProc(LPVOID param)
+{
+	WorkerStart* start = (WorkerStart*)param;
+	WorkerPool* pool = start->pool;
+	HANDLE startEvent = start->startEvent;
+	delete start;
+
+	while(true)
+	{
+		WaitForSingleObject(startEvent, INFINITE);
+		if(pool->quitting)
+			break;
+		pool->work();
+		if(InterlockedDecrement(&pool->busyThreads) == 0)
+			SetEvent(pool->doneEvent);
+	}
+	return 0;
+}
+
+void WorkerPool::work()
+{
+	while(true)
+	{
+		LONG index = InterlockedIncrement(&nextIndex) - 1;
+		if(index >= count)
+			break;
+		job(args[index]);
+	}
+}
+
+void WorkerPool::run(Job job, void** args, int count)
+{
+	if(count <= 0)
+		return;
+
+	// Not worth waking anyone for a single job
+	if(count == 1 || threads.empty())
+	{
+		for(int i = 0; i < count; i++)
+			job(args[i]);
+		return;
+	}
+
+	this->job = job;
+	this->args = args;
+	this->count = count;
+	nextIndex = 0;
+
+	int wake = (int)threads.size();
+	if(wake > count - 1)
+		wake = count - 1;
+	busyThreads = wake;
+	for(int i = 0; i < wake; i++)
+		SetEvent(startEvents[i]);
+
+	work();
+	WaitForSingleObject(doneEvent, INFINITE);
+}
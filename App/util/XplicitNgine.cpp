@@ -1,238 +1,1971 @@
 #include "util/stdafx.h"
 
 #include "Util/XplicitNgine.h"
+#include "Util/PhysicsRecorder.h"
 #include "Globals.h"
+#include <algorithm>
+#include <map>
+
+PhysStats::PhysStats()
+{
+	steps = 0;
+	broadphaseTime = 0;
+	narrowphaseTime = 0;
+	solverTime = 0;
+	syncTime = 0;
+	createTime = 0;
+	deleteTime = 0;
+	rebuildTime = 0;
+	pairs = 0;
+	contacts = 0;
+	awakeBodies = 0;
+	sleepingBodies = 0;
+	bodiesCreated = 0;
+	bodiesDeleted = 0;
+	qualityLevel = 0;
+	solverIterations = 0;
+	contactsPerPair = 0;
+}
 
 XplicitNgine::XplicitNgine() 
 {
 	
-	physWorld = dWorldCreate();
-	physSpace = dHashSpaceCreate(0);
-	contactgroup = dJointGroupCreate(0);
+	broadphase = Enum::Broadphase::Hash;
+	workerPool = NULL;
+	recorder = NULL;
+	mutationDepth = 0;
+	staticEdits = 0;
+	draggedBodies = 0;
+	for(int i = 0; i < 32; i++)
+		groupMasks[i] = 0xFFFFFFFF;
+
+	// 3.6x real time matches the old four 0.03s steps per 30fps frame
+	fixedStepSize = 0.03F;
+	maxCatchUpSteps = 16;
+	timeScale = 3.6F;
+	accumulator = 0;
 
-	dWorldSetGravity(physWorld, 0, -9.8F, 0);
-	dWorldSetAutoDisableFlag(physWorld, 1);
-	dWorldSetAutoDisableLinearThreshold(physWorld, 0.5F);
-	dWorldSetAutoDisableAngularThreshold(physWorld, 0.5F);
-	dWorldSetAutoDisableSteps(physWorld, 20);
+	// Full quality is ODE's 20 iterations and 4 contacts, as before
+	stepBudget = 0;
+	governSteps = false;
+	minIterations = 5;
+	maxIterations = 20;
+	minContacts = 1;
+	maxContacts = 4;
+	minStepsPerFrame = 2;
+	qualityLevel = qualityLevels - 1;
+	solverIterations = maxIterations;
+	contactsPerPair = maxContacts;
+	governedTime = 0;
+	governedFrames = 0;
+	alignedBoxContacts = true;
+
+	// One lane unless asked for more, see setThreadCount
+	setThreadCount(1);
 
 	this->name = "PhysicsService";
+
+	recorder = g_physicsRecorder;
+	if(recorder != NULL)
+		recorder->recordEngine(this);
 }
 
 XplicitNgine::~XplicitNgine() 
 {
-  dJointGroupDestroy (contactgroup);
-  dSpaceDestroy (physSpace);
-  dWorldDestroy (physWorld);
+  touchedGeoms.clear();
+  for(size_t i = 0; i < retiredGeoms.size(); i++)
+    dGeomDestroy(retiredGeoms[i]);
+  // Static geoms belong to no space, so the space can't clean them up
+  Array<dGeomID> statics;
+  staticTree.getMembers(statics);
+  for(int i = 0; i < statics.size(); i++)
+    dGeomDestroy(statics[i]);
+  destroyLanes();
   dCloseODE();
 }
 
+void XplicitNgine::createLanes(int count)
+{
+	for(int i = 0; i < count; i++)
+	{
+		Lane lane;
+		lane.world = dWorldCreate();
+		lane.contactGroup = dJointGroupCreate(0);
+		lane.space = createSpace(broadphase);
+		lane.bodyCount = 0;
+		lane.stepSize = 0;
+
+		dWorldSetGravity(lane.world, 0, -9.8F, 0);
+		dWorldSetAutoDisableFlag(lane.world, 1);
+		dWorldSetAutoDisableLinearThreshold(lane.world, 0.5F);
+		dWorldSetAutoDisableAngularThreshold(lane.world, 0.5F);
+		dWorldSetAutoDisableSteps(lane.world, 20);
+		dWorldSetQuickStepNumIterations(lane.world, solverIterations);
+		lanes.push_back(lane);
+	}
+	physWorld = lanes[0].world;
+	physSpace = lanes[0].space;
+	contactgroup = lanes[0].contactGroup;
+
+	if(count > 1)
+		workerPool = new WorkerPool(count - 1);
+}
+
+void XplicitNgine::destroyLanes()
+{
+	delete workerPool;
+	workerPool = NULL;
+	for(size_t i = 0; i < lanes.size(); i++)
+	{
+		dJointGroupDestroy(lanes[i].contactGroup);
+		dSpaceDestroy(lanes[i].space);
+		dWorldDestroy(lanes[i].world);
+	}
+	lanes.clear();
+}
+
+void XplicitNgine::setThreadCount(int threads)
+{
+	if(recorder != NULL)
+		recorder->recordThreadCount(threads);
+	if(threads < 1)
+		threads = 1;
+	if(threads > 8)
+		threads = 8;
+	for(size_t i = 0; i < lanes.size(); i++)
+	{
+		if(lanes[i].bodyCount > 0)
+			return;
+	}
+	destroyLanes();
+	createLanes(threads);
+}
+
+int XplicitNgine::getThreadCount()
+{
+	return (int)lanes.size();
+}
+
 void XplicitNgine::resetBody(PartInstance* partInstance)
 {
-	deleteBody(partInstance);
-	createBody(partInstance);
+	// Bodiless parts pick up their new state when they're created
+	if(partInstance->physGeom[0] == NULL)
+		return;
+	if(recorder != NULL)
+		recorder->recordReset(partInstance);
+	if(!partInstance->physDirty)
+	{
+		partInstance->physDirty = true;
+		dirtyParts.push_back(partInstance);
+	}
+	if(mutationDepth == 0)
+		applyMutations();
+}
+
+void XplicitNgine::undirtyBody(PartInstance* partInstance)
+{
+	if(partInstance->physDirty)
+	{
+		partInstance->physDirty = false;
+		dirtyParts.erase(std::remove(dirtyParts.begin(), dirtyParts.end(), partInstance), dirtyParts.end());
+	}
+}
+
+void XplicitNgine::beginMutations()
+{
+	if(recorder != NULL)
+		recorder->recordBegin();
+	mutationDepth++;
+}
+
+void XplicitNgine::commitMutations()
+{
+	if(recorder != NULL)
+		recorder->recordCommit();
+	closeBatch();
+}
+
+void XplicitNgine::closeBatch()
+{
+	if(mutationDepth > 0)
+		mutationDepth--;
+	if(mutationDepth == 0)
+		applyMutations();
+}
+
+void XplicitNgine::applyMutations()
+{
+	// Rebuilding retires the old geoms, so wake everything in one go afterwards
+	RealTime start = System::time();
+	mutationDepth++;
+	std::vector<PartInstance*> dirty;
+	dirty.swap(dirtyParts);
+	for(size_t i = 0; i < dirty.size(); i++)
+	{
+		PartInstance* partInstance = dirty[i];
+		partInstance->physDirty = false;
+		refreshBody(partInstance);
+	}
+	mutationDepth--;
+	flushWakes();
+	pendingStats.rebuildTime += (System::time() - start) * 1000;
+}
+
+static void partMass(dMass& mass, const Vector3& partSize)
+{
+	mass.setBox(sqrt(partSize.x*2), sqrt(partSize.y*2), sqrt(partSize.z*2), 0.7F);
+}
+
+static void setBodyMass(dBodyID body, const Vector3& partSize)
+{
+	dMass mass;
+	partMass(mass, partSize);
+	dBodySetMass(body, &mass);
+}
+
+static void toODERotation(const Matrix3& g3dRot, dMatrix3 rotation)
+{
+	for(int i = 0; i < 3; i++)
+	{
+		rotation[i*4] = g3dRot[i][0];
+		rotation[i*4+1] = g3dRot[i][1];
+		rotation[i*4+2] = g3dRot[i][2];
+		rotation[i*4+3] = 0;
+	}
+}
+
+static CoordinateFrame bodyCFrame(dBodyID body)
+{
+	const dReal* physPosition = dBodyGetPosition(body);
+	const dReal* physRotation = dBodyGetRotation(body);
+	return CoordinateFrame(
+		Matrix3(physRotation[0],physRotation[1],physRotation[2],
+				physRotation[4],physRotation[5],physRotation[6],
+				physRotation[8],physRotation[9],physRotation[10]),
+		Vector3(physPosition[0], physPosition[1], physPosition[2]));
+}
+
+static void wakeCallback(void *data, dGeomID o1, dGeomID o2)
+{
+	XplicitNgine* engine = (XplicitNgine*)data;
+	dGeomID geoms[2] = {o1, o2};
+	for(int i = 0; i < 2; i++)
+	{
+		dBodyID body = dGeomGetBody(geoms[i]);
+		if(body != NULL)
+		{
+			engine->wakeBody(body);
+			dGeomEnable(geoms[i]);
+		}
+	}
+}
+
+void XplicitNgine::touchGeom(dGeomID geom)
+{
+	if(touchedGeoms.empty() || touchedGeoms.back() != geom)
+		touchedGeoms.push_back(geom);
+	if(mutationDepth == 0)
+		flushWakes();
+}
+
+void XplicitNgine::wakeTouching(dGeomID geom)
+{
+	for(size_t i = 0; i < lanes.size(); i++)
+		dSpaceCollide2(geom, (dGeomID)lanes[i].space, this, &wakeCallback);
+}
+
+void XplicitNgine::flushWakes()
+{
+	for(size_t i = 0; i < touchedGeoms.size(); i++)
+		wakeTouching(touchedGeoms[i]);
+	touchedGeoms.clear();
+
+	for(size_t i = 0; i < retiredGeoms.size(); i++)
+	{
+		// Anything resting on the removed part has to fall
+		wakeTouching(retiredGeoms[i]);
+		dGeomDestroy(retiredGeoms[i]);
+	}
+	retiredGeoms.clear();
 }
 
 void collisionCallback(void *data, dGeomID o1, dGeomID o2) 
 {
-	int i,n;
+	XplicitNgine* engine = (XplicitNgine*)data;
 	
 	dBodyID b1 = dGeomGetBody(o1);
 	dBodyID b2 = dGeomGetBody(o2);
 	
 	if (b1 && b2 && dAreConnected(b1, b2))
 		return;
-	
-	
+	// Two members of one assembly
+	if (b1 && b1 == b2)
+		return;
 
-	const int N = 4;
-	dContact contact[N];
-	n = dCollide (o1,o2,N,&contact[0].geom,sizeof(dContact));
-	if (n > 0) {
-		for (i=0; i<n; i++) {
-			contact[i].surface.mode = dContactBounce | dContactSlip1 | dContactSlip2 | dContactSoftERP | dContactSoftCFM | dContactApprox1;
-
-			// Define contact surface properties
-			contact[i].surface.bounce = 0.3F; //Elasticity
-			contact[i].surface.mu = 0.3F; //Friction
-			contact[i].surface.slip1 = 0.1F;
-			contact[i].surface.slip2 = 0.1F;
-			contact[i].surface.soft_erp = 1.0F;
-			contact[i].surface.soft_cfm = 0.01F;
-			
-			// Create joints
-			dJointID c = dJointCreateContact(
-				g_xplicitNgine->physWorld,
-				g_xplicitNgine->contactgroup,
-				contact+i
-			);
-			
-			dJointAttach (c,b1,b2);
-			
-			if(b1 != NULL) 
-			{
-				PartInstance* touched = (PartInstance*)dGeomGetData(o2);
-				if(touched != NULL) 
-				{
-					touched->onTouch();
-				}
-			}
+	// Nothing to solve unless at least one side is awake
+	bool awake1 = b1 && dBodyIsEnabled(b1);
+	bool awake2 = b2 && dBodyIsEnabled(b2);
+	if (!awake1 && !awake2)
+		return;
+
+	// ODE enables a sleeping body when it shares an island with an awake one,
+	// so this is where sleeping parts rejoin the active set
+	if (b1 && b2)
+	{
+		if (awake1 && !awake2)
+			engine->wakeBody(b2);
+		else if (awake2 && !awake1)
+			engine->wakeBody(b1);
+	}
+
+	// dCollide runs later, spread over the workers
+	engine->addPair(o1, o2);
+}
+
+// Most contacts the governor can ask for per pair
+static const int maxPairContacts = 8;
+
+// World half extents of a box whose axes line up with the world's, which
+// every part snapped to 90 degree turns does. False for any other rotation.
+static bool alignedHalfExtents(dGeomID geom, dReal half[3])
+{
+	const dReal* rotation = dGeomGetRotation(geom);
+	dVector3 lengths;
+	dGeomBoxGetLengths(geom, lengths);
+	for(int i = 0; i < 3; i++)
+	{
+		int axis = -1;
+		for(int j = 0; j < 3; j++)
+		{
+			dReal value = fabs(rotation[i*4+j]);
+			if(value > 0.9999F)
+				axis = j;
+			else if(value > 0.0001F)
+				return false;
 		}
+		if(axis < 0)
+			return false;
+		half[i] = lengths[axis] / 2;
 	}
+	return true;
 }
 
-void XplicitNgine::deleteBody(PartInstance* partInstance)
+// Contacts between two world-aligned boxes. Their overlap is a box too; it's
+// thinnest along the normal and the contacts are the corners of its cross
+// section, so this is a handful of compares instead of dBoxBox's clipping.
+static int collideAlignedBoxes(dGeomID o1, dGeomID o2, const dReal half1[3], const dReal half2[3], int maxContacts, dContact* contact)
 {
-	if(partInstance->physBody != NULL)
+	const dReal* p1 = dGeomGetPosition(o1);
+	const dReal* p2 = dGeomGetPosition(o2);
+	dReal low[3];
+	dReal high[3];
+	dReal depth = dInfinity;
+	int axis = 0;
+	for(int i = 0; i < 3; i++)
 	{
-		dBodyEnable(partInstance->physBody);
-		dGeomEnable(partInstance->physGeom[0]);
-		if(partInstance->isAnchored() || partInstance->isDragging())
+		dReal low1 = p1[i] - half1[i];
+		dReal low2 = p2[i] - half2[i];
+		dReal high1 = p1[i] + half1[i];
+		dReal high2 = p2[i] + half2[i];
+		low[i] = low1 > low2 ? low1 : low2;
+		high[i] = high1 < high2 ? high1 : high2;
+		dReal overlap = high[i] - low[i];
+		if(overlap < 0)
+			return 0;
+		if(overlap < depth)
 		{
-			dGeomSetBody(partInstance->physGeom[0], partInstance->physBody);
-			dGeomEnable(partInstance->physGeom[0]);
-			updateBody(partInstance);
-			step(0.03F);
+			depth = overlap;
+			axis = i;
 		}
+	}
 
-		for(int i = 0; i < dBodyGetNumJoints(partInstance->physBody); i++) {
-			dBodyID b1 = dJointGetBody(dBodyGetJoint(partInstance->physBody, i), 0);
-			dBodyID b2 = dJointGetBody(dBodyGetJoint(partInstance->physBody, i), 1);
-			
-			if(b1 != NULL)
-			{
-				dBodyEnable(b1);
-				PartInstance * part = (PartInstance *)dBodyGetData(b1);
-				if(part != NULL)
-					dGeomEnable(part->physGeom[0]);
-			}
+	// Pushes o1 out of o2, as ODE's colliders do
+	dVector3 normal = {0, 0, 0, 0};
+	normal[axis] = p1[axis] >= p2[axis] ? 1 : -1;
+	int axis1 = (axis + 1) % 3;
+	int axis2 = (axis + 2) % 3;
+	dReal middle = (low[axis] + high[axis]) / 2;
 
-			if(b2 != NULL)
-			{
-				dBodyEnable(b2);
-				PartInstance * part = (PartInstance *)dBodyGetData(b2);
-				if(part != NULL)
-					dGeomEnable(part->physGeom[0]);
-			}
-			dJointDestroy(dBodyGetJoint(partInstance->physBody, i));
+	// Diagonal corners first, so fewer contacts still span the face
+	const int cornerCount = 4;
+	const dReal corners[cornerCount][2] = {
+		{low[axis1], low[axis2]},
+		{high[axis1], high[axis2]},
+		{low[axis1], high[axis2]},
+		{high[axis1], low[axis2]}
+	};
+	int n = maxContacts < cornerCount ? maxContacts : cornerCount;
+	for(int i = 0; i < n; i++)
+	{
+		dContactGeom& geom = contact[i].geom;
+		geom.pos[axis] = middle;
+		if(n == 1)
+		{
+			geom.pos[axis1] = (low[axis1] + high[axis1]) / 2;
+			geom.pos[axis2] = (low[axis2] + high[axis2]) / 2;
+		}
+		else
+		{
+			geom.pos[axis1] = corners[i][0];
+			geom.pos[axis2] = corners[i][1];
 		}
+		geom.pos[3] = 0;
+		for(int j = 0; j < 4; j++)
+			geom.normal[j] = normal[j];
+		geom.depth = depth;
+		geom.g1 = o1;
+		geom.g2 = o2;
+		geom.side1 = geom.side2 = 0;
+	}
+	return n;
+}
+
+// Narrowphase for one pair, safe to run on any thread
+static void collidePair(dGeomID o1, dGeomID o2, int maxContacts, bool alignedBoxes, std::vector<dContact>& contacts)
+{
+	int i,n;
+	dContact contact[maxPairContacts];
+	dReal half1[3];
+	dReal half2[3];
+	if(alignedBoxes && dGeomGetClass(o1) == dBoxClass && dGeomGetClass(o2) == dBoxClass &&
+		alignedHalfExtents(o1, half1) && alignedHalfExtents(o2, half2))
+		n = collideAlignedBoxes(o1, o2, half1, half2, maxContacts, contact);
+	else
+		n = dCollide (o1,o2,maxContacts,&contact[0].geom,sizeof(dContact));
+	for (i=0; i<n; i++) {
+		contact[i].surface.mode = dContactBounce | dContactSlip1 | dContactSlip2 | dContactSoftERP | dContactSoftCFM | dContactApprox1;
+
+		// Define contact surface properties
+		contact[i].surface.bounce = 0.3F; //Elasticity
+		contact[i].surface.mu = 0.3F; //Friction
+		contact[i].surface.slip1 = 0.1F;
+		contact[i].surface.slip2 = 0.1F;
+		contact[i].surface.soft_erp = 1.0F;
+		contact[i].surface.soft_cfm = 0.01F;
+
+		contacts.push_back(contact[i]);
+	}
+}
+
+void XplicitNgine::deleteBody(PartInstance* partInstance)
+{
+	if(recorder != NULL && (partInstance->physGeom[0] != NULL || partInstance->physQueued))
+		recorder->recordDelete(partInstance);
+	RealTime start = System::time();
+	removeBody(partInstance);
+	pendingStats.deleteTime += (System::time() - start) * 1000;
+}
+
+void XplicitNgine::removeBody(PartInstance* partInstance)
+{
+	dequeueBody(partInstance);
+	undirtyBody(partInstance);
+	if(partInstance->physRoot != NULL)
+		dissolveAssembly(partInstance->physRoot, partInstance);
+	removeActive(partInstance);
+	destroyPhysBody(partInstance);
+
+	dGeomID geom = partInstance->physGeom[0];
+	if(geom != NULL)
+	{
+		// Keep the geom around until the neighbours it touched have been woken
+		partInstance->physGeom[0] = NULL;
+		dGeomSetData(geom, NULL);
+		if(dGeomGetSpace(geom) != NULL)
+			dSpaceRemove(dGeomGetSpace(geom), geom);
+		else
+			removeStatic(geom);
+		touchedGeoms.erase(std::remove(touchedGeoms.begin(), touchedGeoms.end(), geom), touchedGeoms.end());
+		retiredGeoms.push_back(geom);
+		if(mutationDepth == 0)
+			flushWakes();
+	}
+}
+
+void XplicitNgine::createPhysBody(PartInstance* partInstance)
+{
+	Vector3 velocity = partInstance->getVelocity();
+	Vector3 rotVelocity = partInstance->getRotVelocity();
+
+	partInstance->physLane = pickLane();
+	lanes[partInstance->physLane].bodyCount++;
+	pendingStats.bodiesCreated++;
+	partInstance->physBody = dBodyCreate(lanes[partInstance->physLane].world);
+	dBodySetData(partInstance->physBody, partInstance);
+	setBodyMass(partInstance->physBody, partInstance->getSize());
+	dBodySetLinearVel(partInstance->physBody, velocity.x, velocity.y, velocity.z);
+	dBodySetAngularVel(partInstance->physBody, rotVelocity.x, rotVelocity.y, rotVelocity.z);
+}
+
+void XplicitNgine::setDragged(PartInstance* partInstance, bool dragged)
+{
+	if(partInstance->physDragged == dragged)
+		return;
+	partInstance->physDragged = dragged;
+	draggedBodies += dragged ? 1 : -1;
+}
+
+void XplicitNgine::destroyPhysBody(PartInstance* partInstance)
+{
+	if(partInstance->physBody != NULL)
+	{
+		setDragged(partInstance, false);
 		dBodyDestroy(partInstance->physBody);
-		dGeomDestroy(partInstance->physGeom[0]);
 		partInstance->physBody = NULL;
+		lanes[partInstance->physLane].bodyCount--;
+		pendingStats.bodiesDeleted++;
 	}
 }
 
 void XplicitNgine::createBody(PartInstance* partInstance)
 {
-	if(partInstance->physBody == NULL) 
+	if(recorder != NULL && partInstance->physGeom[0] == NULL)
+		recorder->recordCreate(partInstance);
+	RealTime start = System::time();
+	addBody(partInstance);
+	pendingStats.createTime += (System::time() - start) * 1000;
+}
+
+void XplicitNgine::addBody(PartInstance* partInstance)
+{
+	dequeueBody(partInstance);
+	if(partInstance->physGeom[0] == NULL) 
 	{
 		
 		Vector3 partSize = partInstance->getSize();
-		Vector3 partPosition = partInstance->getPosition();
-		Vector3 velocity = partInstance->getVelocity();
-		Vector3 rotVelocity = partInstance->getRotVelocity();
-		
-		// init body
-		partInstance->physBody = dBodyCreate(physWorld);
-		dBodySetData(partInstance->physBody, partInstance);
 		
-		
-		// Create geom
+		// Create geom, outside any space until we know where it goes
 		if(partInstance->shape == Enum::Shape::Block)
 		{
-			partInstance->physGeom[0] = dCreateBox(physSpace,
+			partInstance->physGeom[0] = dCreateBox(0,
 					partSize.x,
 					partSize.y,
 					partSize.z
 				);
-
-			dVector3 result;
-			dGeomBoxGetLengths(partInstance->physGeom[0], result);
 		}
 		else
 		{
-			partInstance->physGeom[0] = dCreateSphere(physSpace, partSize[0]/2);
+			partInstance->physGeom[0] = dCreateSphere(0, partSize[0]/2);
 		}
-		
-		if(partInstance->physGeom[0])
-			dGeomSetData(partInstance->physGeom[0], partInstance);
+		dGeomSetData(partInstance->physGeom[0], partInstance);
+		applyCollisionBits(partInstance);
 
-		dMass mass;
-		mass.setBox(sqrt(partSize.x*2), sqrt(partSize.y*2), sqrt(partSize.z*2), 0.7F);
-		dBodySetMass(partInstance->physBody, &mass);
+		// Anchored parts are only ever collided against, they get no body.
+		// Dragged parts keep theirs for when they're let go.
+		if(!partInstance->isAnchored())
+			createPhysBody(partInstance);
 
-		// Create rigid body
-		dBodySetPosition(partInstance->physBody, 
-			partPosition.x,
-			partPosition.y,
-			partPosition.z
-		);
+		if(!partInstance->isAnchored() && !partInstance->isDragging())
+		{
+			dSpaceAdd(lanes[partInstance->physLane].space, partInstance->physGeom[0]);
+			dGeomSetBody(partInstance->physGeom[0], partInstance->physBody);
+			placeBody(partInstance);
+		}
+		else
+		{
+			if(partInstance->physBody != NULL)
+			{
+				dBodyDisable(partInstance->physBody);
+				setDragged(partInstance, true);
+			}
+			placeBody(partInstance);
+			addStatic(partInstance->physGeom[0]);
+		}
+	}
+}
+
+void XplicitNgine::refreshBody(PartInstance* partInstance)
+{
+	if(partInstance->physRoot != NULL)
+		dissolveAssembly(partInstance->physRoot, partInstance);
 
-		dGeomSetPosition(partInstance->physGeom[0], 
-			partPosition.x,
-			partPosition.y,
-			partPosition.z);
+	dGeomID geom = partInstance->physGeom[0];
+	int geomClass = partInstance->shape == Enum::Shape::Block ? dBoxClass : dSphereClass;
+	if(dGeomGetClass(geom) != geomClass)
+	{
+		// Only a new shape needs a new geom
+		removeBody(partInstance);
+		addBody(partInstance);
+		return;
+	}
 
-		dBodySetLinearVel(partInstance->physBody, velocity.x, velocity.y, velocity.z);
-		dBodySetAngularVel(partInstance->physBody, rotVelocity.x, rotVelocity.y, rotVelocity.z);
+	Vector3 partSize = partInstance->getSize();
+	bool isStatic = dGeomGetSpace(geom) == NULL;
+	bool wantStatic = partInstance->isAnchored() || partInstance->isDragging();
 
-		Matrix3 g3dRot = partInstance->getCFrame().rotation;
-		float rotation [12] = {	g3dRot[0][0], g3dRot[0][1], g3dRot[0][2], 0,
-								g3dRot[1][0], g3dRot[1][1], g3dRot[1][2], 0,
-								g3dRot[2][0], g3dRot[2][1], g3dRot[2][2], 0};
-		dGeomSetRotation(partInstance->physGeom[0], rotation);
-		dBodySetRotation(partInstance->physBody, rotation);
+	if(isStatic)
+		removeStatic(geom);
+	applyCollisionBits(partInstance);
+	if(geomClass == dBoxClass)
+		dGeomBoxSetLengths(geom, partSize.x, partSize.y, partSize.z);
+	else
+		dGeomSphereSetRadius(geom, partSize.x/2);
 
-		if(!partInstance->isAnchored() && !partInstance->isDragging())
-			dGeomSetBody(partInstance->physGeom[0], partInstance->physBody);
+	if(partInstance->isAnchored())
+		destroyPhysBody(partInstance);
+	else if(partInstance->physBody == NULL)
+		createPhysBody(partInstance);
+	else
+		setBodyMass(partInstance->physBody, partSize);
 
-	} else {
-		if(!partInstance->isAnchored() && !partInstance->isDragging())
+	if(!wantStatic)
+	{
+		if(partInstance->physBody != NULL)
+			setDragged(partInstance, false);
+		// A new body may have gone to another lane than the geom's space
+		setGeomLane(geom, partInstance->physLane);
+		if(dGeomGetBody(geom) == NULL)
+		{
+			Vector3 velocity = partInstance->getVelocity();
+			Vector3 rotVelocity = partInstance->getRotVelocity();
+			dBodySetLinearVel(partInstance->physBody, velocity.x, velocity.y, velocity.z);
+			dBodySetAngularVel(partInstance->physBody, rotVelocity.x, rotVelocity.y, rotVelocity.z);
+			dGeomSetBody(geom, partInstance->physBody);
+		}
+		placeBody(partInstance);
+	}
+	else
+	{
+		if(!isStatic)
+		{
+			dGeomSetBody(geom, NULL);
+			dSpaceRemove(dGeomGetSpace(geom), geom);
+			removeActive(partInstance);
+		}
+		if(partInstance->physBody != NULL)
 		{
-			const dReal* velocity = dBodyGetLinearVel(partInstance->physBody);
-			const dReal* rotVelocity = dBodyGetAngularVel(partInstance->physBody);
-			
-			partInstance->setVelocity(Vector3(velocity[0],velocity[1],velocity[2]));
-			partInstance->setRotVelocity(Vector3(rotVelocity[0],rotVelocity[1],rotVelocity[2]));
+			dBodyDisable(partInstance->physBody);
+			setDragged(partInstance, true);
+		}
+		placeBody(partInstance);
+		addStatic(geom);
+	}
+	touchGeom(geom);
+}
+
+void XplicitNgine::applyCollisionBits(PartInstance* partInstance)
+{
+	dGeomID geom = partInstance->physGeom[0];
+	if(partInstance->canCollide)
+	{
+		dGeomSetCategoryBits(geom, 1UL << partInstance->collisionGroup);
+		dGeomSetCollideBits(geom, groupMasks[partInstance->collisionGroup]);
+	}
+	else
+	{
+		// Decorative, nothing ever pairs with it
+		dGeomSetCategoryBits(geom, 0);
+		dGeomSetCollideBits(geom, 0);
+	}
+}
+
+void XplicitNgine::setGroupsCollide(int group1, int group2, bool collide)
+{
+	if(group1 < 0 || group1 > 31 || group2 < 0 || group2 > 31)
+		return;
+	if(getGroupsCollide(group1, group2) == collide)
+		return;
+	if(recorder != NULL)
+		recorder->recordGroupsCollide(group1, group2, collide);
+
+	if(collide)
+	{
+		groupMasks[group1] |= 1UL << group2;
+		groupMasks[group2] |= 1UL << group1;
+	}
+	else
+	{
+		groupMasks[group1] &= ~(1UL << group2);
+		groupMasks[group2] &= ~(1UL << group1);
+	}
 
-			const dReal* physPosition = dBodyGetPosition(partInstance->physBody);
-			
-			const dReal* physRotation = dGeomGetRotation(partInstance->physGeom[0]);
-			partInstance->setCFrameNoSync(CoordinateFrame(
-				Matrix3(physRotation[0],physRotation[1],physRotation[2],
-						physRotation[4],physRotation[5],physRotation[6],
-						physRotation[8],physRotation[9],physRotation[10]),
-				Vector3(physPosition[0], physPosition[1], physPosition[2])));
+	// Refresh collide bits of every geom in either group. Pairs that can
+	// touch now need their sleepers woken.
+	mutationDepth++;
+	for(size_t i = 0; i < lanes.size(); i++)
+	{
+		int count = dSpaceGetNumGeoms(lanes[i].space);
+		for(int j = 0; j < count; j++)
+		{
+			dGeomID geom = dSpaceGetGeom(lanes[i].space, j);
+			PartInstance* partInstance = (PartInstance*)dGeomGetData(geom);
+			if(partInstance == NULL || !partInstance->canCollide)
+				continue;
+			if(partInstance->collisionGroup != group1 && partInstance->collisionGroup != group2)
+				continue;
+			applyCollisionBits(partInstance);
+			if(collide)
+				touchGeom(geom);
 		}
 	}
+	for(AABSPTree<dGeomID>::Iterator it = staticTree.begin(); it != staticTree.end(); ++it)
+	{
+		PartInstance* partInstance = (PartInstance*)dGeomGetData(*it);
+		if(partInstance == NULL)
+			continue;
+		if(partInstance->collisionGroup != group1 && partInstance->collisionGroup != group2)
+			continue;
+		applyCollisionBits(partInstance);
+		if(collide)
+			touchGeom(*it);
+	}
+	closeBatch();
+}
+
+bool XplicitNgine::getGroupsCollide(int group1, int group2)
+{
+	if(group1 < 0 || group1 > 31 || group2 < 0 || group2 > 31)
+		return false;
+	return (groupMasks[group1] & (1UL << group2)) != 0;
+}
+
+void XplicitNgine::addStatic(dGeomID geom)
+{
+	// Nothing would ever ask for it
+	if(dGeomGetCategoryBits(geom) == 0)
+		return;
+	staticTree.insert(geom);
+	staticEdits++;
+}
+
+void XplicitNgine::removeStatic(dGeomID geom)
+{
+	if(!staticTree.contains(geom))
+		return;
+	staticTree.remove(geom);
+	staticEdits++;
+}
+
+void XplicitNgine::collideStatic()
+{
+	// Rebalance once enough has changed since the last time
+	if(staticEdits * 8 > staticTree.size())
+	{
+		staticTree.balance();
+		staticEdits = 0;
+	}
+
+	// Only awake bodies can hit anything static, so they do the asking
+	for(size_t i = 0; i < activeParts.size(); i++)
+	{
+		PartInstance* partInstance = activeParts[i];
+		collideStaticGeom(partInstance->physGeom[0]);
+		for(size_t j = 0; j < partInstance->physWelded.size(); j++)
+			collideStaticGeom(partInstance->physWelded[j]->physGeom[0]);
+	}
+}
+
+void XplicitNgine::collideStaticGeom(dGeomID geom)
+{
+	if(!dGeomIsEnabled(geom))
+		return;
+	unsigned long category = dGeomGetCategoryBits(geom);
+	unsigned long collide = dGeomGetCollideBits(geom);
+	if(category == 0 && collide == 0)
+		return;
+	dReal aabb[6];
+	dGeomGetAABB(geom, aabb);
+	AABox bounds(Vector3(aabb[0] - 0.01F, aabb[2] - 0.01F, aabb[4] - 0.01F), Vector3(aabb[1] + 0.01F, aabb[3] + 0.01F, aabb[5] + 0.01F));
+
+	staticHits.fastClear();
+	staticTree.getIntersectingMembers(bounds, staticHits);
+	for(int i = 0; i < staticHits.size(); i++)
+	{
+		dGeomID hit = staticHits[i];
+		if(!(category & dGeomGetCollideBits(hit)) && !(collide & dGeomGetCategoryBits(hit)))
+			continue;
+		collisionCallback(this, geom, hit);
+	}
 }
 
 void XplicitNgine::step(float stepSize)
 {	
-	dJointGroupEmpty(contactgroup);
-	dSpaceCollide (physSpace,0,&collisionCallback);
-	dWorldQuickStep(physWorld, stepSize);
+	RealTime start = System::time();
+	for(size_t i = 0; i < lanes.size(); i++)
+		dJointGroupEmpty(lanes[i].contactGroup);
+	candidatePairs.clear();
+	pendingContacts.clear();
+	collide();
+	RealTime collided = System::time();
+	narrowphase();
+	RealTime contacted = System::time();
+	if(lanes.size() > 1)
+		gatherIslands();
+	createContactJoints();
+	stepLanes(stepSize);
+	if(lanes.size() > 1)
+		countIdleSteps();
+	RealTime solved = System::time();
+
+	stepStats.steps = 1;
+	stepStats.qualityLevel = qualityLevel;
+	stepStats.solverIterations = solverIterations;
+	stepStats.contactsPerPair = contactsPerPair;
+	stepStats.broadphaseTime = (collided - start) * 1000;
+	stepStats.narrowphaseTime = (contacted - collided) * 1000;
+	stepStats.solverTime = (solved - contacted) * 1000;
+	stepStats.pairs = (int)candidatePairs.size();
+	stepStats.contacts = (int)pendingContacts.size();
+
+	pendingStats.broadphaseTime += stepStats.broadphaseTime;
+	pendingStats.narrowphaseTime += stepStats.narrowphaseTime;
+	pendingStats.solverTime += stepStats.solverTime;
+	pendingStats.pairs += stepStats.pairs;
+	pendingStats.contacts += stepStats.contacts;
 }
 
-void XplicitNgine::updateBody(PartInstance *partInstance)
+void XplicitNgine::addPair(dGeomID o1, dGeomID o2)
 {
-	if(partInstance->physBody != NULL)
-	{
-		Vector3 position = partInstance->getCFrame().translation;
+	GeomPair pair;
+	pair.o1 = o1;
+	pair.o2 = o2;
+	candidatePairs.push_back(pair);
+}
 
-		dBodySetPosition(partInstance->physBody, 
-			position[0],
-			position[1],
-			position[2]
-		);
-		dBodyEnable(partInstance->physBody);
-		dGeomEnable(partInstance->physGeom[0]);
+void XplicitNgine::collideBatch(void* arg)
+{
+	NarrowphaseBatch* batch = (NarrowphaseBatch*)arg;
+	batch->contacts.clear();
+	for(int i = 0; i < batch->count; i++)
+		collidePair(batch->pairs[i].o1, batch->pairs[i].o2, batch->maxContacts, batch->alignedBoxes, batch->contacts);
+}
+
+void XplicitNgine::narrowphase()
+{
+	int pairCount = (int)candidatePairs.size();
+	if(pairCount == 0)
+		return;
 
-		Matrix3 g3dRot = partInstance->getCFrame().rotation;
-		float rotation [12] = {	g3dRot[0][0], g3dRot[0][1], g3dRot[0][2], 0,
-								g3dRot[1][0], g3dRot[1][1], g3dRot[1][2], 0,
-								g3dRot[2][0], g3dRot[2][1], g3dRot[2][2], 0};
+	// ODE updates a moved geom's transform lazily on first use. Do that here
+	// so the workers only read geoms.
+	for(int i = 0; i < pairCount; i++)
+	{
+		dGeomGetPosition(candidatePairs[i].o1);
+		dGeomGetPosition(candidatePairs[i].o2);
+	}
 
-		dBodySetRotation(partInstance->physBody, rotation);
+	// A few batches per thread so uneven pairs even out; small scenes stay on this thread
+	int batchCount = 1;
+	if(workerPool != NULL)
+	{
+		batchCount = (workerPool->getThreadCount() + 1) * 4;
+		if(batchCount > pairCount / 64)
+			batchCount = pairCount / 64;
+		if(batchCount < 1)
+			batchCount = 1;
+	}
+	if((int)narrowphaseBatches.size() < batchCount)
+		narrowphaseBatches.resize(batchCount);
+
+	std::vector<void*> jobs(batchCount);
+	int first = 0;
+	for(int i = 0; i < batchCount; i++)
+	{
+		int last = (int)(((long long)pairCount * (i + 1)) / batchCount);
+		narrowphaseBatches[i].pairs = &candidatePairs[first];
+		narrowphaseBatches[i].count = last - first;
+		narrowphaseBatches[i].maxContacts = contactsPerPair;
+		narrowphaseBatches[i].alignedBoxes = alignedBoxContacts;
+		jobs[i] = &narrowphaseBatches[i];
+		first = last;
 	}
-}
\ No newline at end of file
+
+	if(batchCount > 1)
+		workerPool->run(&XplicitNgine::collideBatch, &jobs[0], batchCount);
+	else
+		collideBatch(jobs[0]);
+
+	// Gather in batch order so the contact list doesn't depend on thread timing
+	for(int i = 0; i < batchCount; i++)
+	{
+		const std::vector<dContact>& contacts = narrowphaseBatches[i].contacts;
+		for(size_t j = 0; j < contacts.size(); j++)
+		{
+			pendingContacts.push_back(contacts[j]);
+			if(dGeomGetBody(contacts[j].geom.g1) != NULL)
+			{
+				PartInstance* touched = (PartInstance*)dGeomGetData(contacts[j].geom.g2);
+				if(touched != NULL)
+					touched->onTouch();
+			}
+		}
+	}
+}
+
+int XplicitNgine::pickLane()
+{
+	int lane = 0;
+	for(size_t i = 1; i < lanes.size(); i++)
+	{
+		if(lanes[i].bodyCount < lanes[lane].bodyCount)
+			lane = (int)i;
+	}
+	return lane;
+}
+
+void XplicitNgine::setGeomLane(dGeomID geom, int lane)
+{
+	dSpaceID space = dGeomGetSpace(geom);
+	if(space == lanes[lane].space)
+		return;
+	if(space != NULL)
+		dSpaceRemove(space, geom);
+	dSpaceAdd(lanes[lane].space, geom);
+}
+
+void XplicitNgine::moveBody(PartInstance* partInstance, int lane)
+{
+	// ODE can't move a body between worlds, so rebuild it in the new one.
+	// Only contact joints exist and none are made until every island has
+	// settled on its lane.
+	dBodyID oldBody = partInstance->physBody;
+	dBodyID body = dBodyCreate(lanes[lane].world);
+	dBodySetData(body, partInstance);
+
+	dMass mass;
+	dBodyGetMass(oldBody, &mass);
+	dBodySetMass(body, &mass);
+	const dReal* position = dBodyGetPosition(oldBody);
+	dBodySetPosition(body, position[0], position[1], position[2]);
+	dBodySetRotation(body, dBodyGetRotation(oldBody));
+	const dReal* velocity = dBodyGetLinearVel(oldBody);
+	dBodySetLinearVel(body, velocity[0], velocity[1], velocity[2]);
+	const dReal* rotVelocity = dBodyGetAngularVel(oldBody);
+	dBodySetAngularVel(body, rotVelocity[0], rotVelocity[1], rotVelocity[2]);
+
+	// Carry over how long it has been resting. dBodyEnable restarts the
+	// countdown to sleep from the body's idle steps, so shorten those for the
+	// restart and put them back after.
+	int idleSteps = dBodyGetAutoDisableSteps(oldBody);
+	int stepsLeft = idleSteps - partInstance->physIdleSteps;
+	if(stepsLeft < 1)
+		stepsLeft = 1;
+	dBodySetAutoDisableFlag(body, dBodyGetAutoDisableFlag(oldBody));
+	dBodySetAutoDisableLinearThreshold(body, dBodyGetAutoDisableLinearThreshold(oldBody));
+	dBodySetAutoDisableAngularThreshold(body, dBodyGetAutoDisableAngularThreshold(oldBody));
+	dBodySetAutoDisableTime(body, dBodyGetAutoDisableTime(oldBody));
+	dBodySetAutoDisableSteps(body, stepsLeft);
+	dBodyEnable(body);
+	dBodySetAutoDisableSteps(body, idleSteps);
+	if(!dBodyIsEnabled(oldBody))
+		dBodyDisable(body);
+
+	attachGeom(partInstance, body);
+	for(size_t i = 0; i < partInstance->physWelded.size(); i++)
+		attachGeom(partInstance->physWelded[i], body);
+	dBodyDestroy(oldBody);
+	partInstance->physBody = body;
+
+	lanes[partInstance->physLane].bodyCount--;
+	lanes[lane].bodyCount++;
+	partInstance->physLane = lane;
+}
+
+static int findIsland(std::vector<int>& parents, int i)
+{
+	while(parents[i] != i)
+	{
+		parents[i] = parents[parents[i]];
+		i = parents[i];
+	}
+	return i;
+}
+
+int XplicitNgine::islandIndex(dBodyID body)
+{
+	PartInstance* partInstance = (PartInstance*)dBodyGetData(body);
+	if(partInstance->physActiveIndex >= 0)
+		return partInstance->physActiveIndex;
+	// Few bodies outside the active set turn up in contacts, a scan will do
+	for(size_t i = activeParts.size(); i < islandParts.size(); i++)
+	{
+		if(islandParts[i] == partInstance)
+			return (int)i;
+	}
+	int index = (int)islandParts.size();
+	islandParts.push_back(partInstance);
+	islandParents.push_back(index);
+	return index;
+}
+
+void XplicitNgine::gatherIslands()
+{
+	// Union every pair of bodies in contact. Awake parts take the first
+	// indices, in active order, so the root of an island is its lowest active
+	// index and the outcome only depends on that order. Any other body in a
+	// contact is numbered after them as it turns up.
+	islandParts.assign(activeParts.begin(), activeParts.end());
+	islandParents.resize(activeParts.size());
+	for(size_t i = 0; i < islandParents.size(); i++)
+		islandParents[i] = (int)i;
+
+	for(size_t i = 0; i < pendingContacts.size(); i++)
+	{
+		dBodyID b1 = dGeomGetBody(pendingContacts[i].geom.g1);
+		dBodyID b2 = dGeomGetBody(pendingContacts[i].geom.g2);
+		if(b1 == NULL || b2 == NULL)
+			continue;
+		int a = findIsland(islandParents, islandIndex(b1));
+		int b = findIsland(islandParents, islandIndex(b2));
+		if(a < b)
+			islandParents[b] = a;
+		else if(b < a)
+			islandParents[a] = b;
+	}
+
+	// Pull every island into the lane of its root, before any joint exists
+	for(size_t i = 0; i < islandParts.size(); i++)
+	{
+		int lane = islandParts[findIsland(islandParents, (int)i)]->physLane;
+		if(islandParts[i]->physLane != lane)
+			moveBody(islandParts[i], lane);
+	}
+}
+
+void XplicitNgine::createContactJoints()
+{
+	for(size_t i = 0; i < pendingContacts.size(); i++)
+	{
+		dContact& contact = pendingContacts[i];
+		dBodyID b1 = dGeomGetBody(contact.geom.g1);
+		dBodyID b2 = dGeomGetBody(contact.geom.g2);
+		if(b1 == NULL && b2 == NULL)
+			continue;
+
+		// gatherIslands has put both bodies in the same lane
+		dBodyID owner = b1 != NULL ? b1 : b2;
+		Lane& lane = lanes[((PartInstance*)dBodyGetData(owner))->physLane];
+		dJointID joint = dJointCreateContact(lane.world, lane.contactGroup, &contact);
+		dJointAttach(joint, b1, b2);
+	}
+}
+
+void XplicitNgine::countIdleSteps()
+{
+	// ODE keeps each body's countdown to sleep to itself. Follow it here with
+	// the same test so moveBody can carry it over.
+	for(size_t i = 0; i < activeParts.size(); i++)
+	{
+		PartInstance* partInstance = activeParts[i];
+		dBodyID body = partInstance->physBody;
+		const dReal* velocity = dBodyGetLinearVel(body);
+		const dReal* rotVelocity = dBodyGetAngularVel(body);
+		dReal linear = dBodyGetAutoDisableLinearThreshold(body);
+		dReal angular = dBodyGetAutoDisableAngularThreshold(body);
+		if(dDOT(velocity, velocity) <= linear * linear && dDOT(rotVelocity, rotVelocity) <= angular * angular)
+			partInstance->physIdleSteps++;
+		else
+			partInstance->physIdleSteps = 0;
+	}
+}
+
+void XplicitNgine::stepLane(void* arg)
+{
+	Lane* lane = (Lane*)arg;
+	dWorldQuickStep(lane->world, lane->stepSize);
+}
+
+void XplicitNgine::stepLanes(float stepSize)
+{
+	std::vector<void*> jobs;
+	for(size_t i = 0; i < lanes.size(); i++)
+	{
+		if(lanes[i].bodyCount == 0)
+			continue;
+		lanes[i].stepSize = stepSize;
+		jobs.push_back(&lanes[i]);
+	}
+	if(jobs.empty())
+		return;
+
+	if(workerPool != NULL)
+		workerPool->run(&XplicitNgine::stepLane, &jobs[0], (int)jobs.size());
+	else
+		stepLane(jobs[0]);
+}
+
+dSpaceID XplicitNgine::createSpace(Enum::Broadphase::Value broadphase)
+{
+	switch(broadphase)
+	{
+	case Enum::Broadphase::QuadTree:
+		{
+			dVector3 center = {0, 0, 0};
+			dVector3 extents = {1024, 1024, 1024};
+			return dQuadTreeSpaceCreate(0, center, extents, 7);
+		}
+	case Enum::Broadphase::Simple:
+	case Enum::Broadphase::SweepAndPrune:
+		// The sweep only uses the space to hold its geoms
+		return dSimpleSpaceCreate(0);
+	default:
+		{
+			// Cells from half a stud (plates) up to a 512 stud baseplate
+			dSpaceID space = dHashSpaceCreate(0);
+			dHashSpaceSetLevels(space, -1, 9);
+			return space;
+		}
+	}
+}
+
+void XplicitNgine::setBroadphase(Enum::Broadphase::Value broadphase)
+{
+	if(recorder != NULL)
+		recorder->recordBroadphase(broadphase);
+	for(size_t i = 0; i < lanes.size(); i++)
+	{
+		dSpaceID oldSpace = lanes[i].space;
+		dSpaceID newSpace = createSpace(broadphase);
+		while(dSpaceGetNumGeoms(oldSpace) > 0)
+		{
+			dGeomID geom = dSpaceGetGeom(oldSpace, 0);
+			dSpaceRemove(oldSpace, geom);
+			dSpaceAdd(newSpace, geom);
+		}
+		dSpaceDestroy(oldSpace);
+		lanes[i].space = newSpace;
+	}
+	physSpace = lanes[0].space;
+	this->broadphase = broadphase;
+}
+
+Enum::Broadphase::Value XplicitNgine::getBroadphase()
+{
+	return broadphase;
+}
+
+void XplicitNgine::collide()
+{
+	if(broadphase == Enum::Broadphase::SweepAndPrune)
+		sweepAndPrune(false);
+	else
+	{
+		// Each lane's space finds its own pairs. Pairs that straddle two lanes
+		// come from one sweep over every lane, so the cost doesn't grow with
+		// the number of lanes.
+		for(size_t i = 0; i < lanes.size(); i++)
+			dSpaceCollide(lanes[i].space, this, &collisionCallback);
+		if(lanes.size() > 1)
+			sweepAndPrune(true);
+	}
+	collideStatic();
+}
+
+namespace
+{
+	struct SweepLess
+	{
+		int axis;
+		SweepLess(int axis) : axis(axis) {}
+		template <class T>
+		bool operator()(const T& a, const T& b) const
+		{
+			return a.aabb[axis*2] < b.aabb[axis*2];
+		}
+	};
+
+	bool sweepAsleep(dGeomID geom)
+	{
+		dBodyID body = dGeomGetBody(geom);
+		return body == NULL || !dBodyIsEnabled(body);
+	}
+}
+
+void XplicitNgine::sweepAndPrune(bool acrossLanes)
+{
+	int count = 0;
+	for(size_t i = 0; i < lanes.size(); i++)
+		count += dSpaceGetNumGeoms(lanes[i].space);
+	sweepEntries.resize(count);
+
+	// Sort along whichever axis the build is spread out on. Brick worlds are
+	// wide and flat, so this is almost never Y, where everything overlaps.
+	dReal low[3] = {dInfinity, dInfinity, dInfinity};
+	dReal high[3] = {-dInfinity, -dInfinity, -dInfinity};
+	int used = 0;
+	for(size_t i = 0; i < lanes.size(); i++)
+	{
+		int laneCount = dSpaceGetNumGeoms(lanes[i].space);
+		for(int j = 0; j < laneCount; j++)
+		{
+			dGeomID geom = dSpaceGetGeom(lanes[i].space, j);
+			if(!dGeomIsEnabled(geom))
+				continue;
+			// canCollide off, it can't pair with anything
+			if(dGeomGetCategoryBits(geom) == 0 && dGeomGetCollideBits(geom) == 0)
+				continue;
+			SweepEntry& entry = sweepEntries[used++];
+			entry.geom = geom;
+			entry.lane = (int)i;
+			dGeomGetAABB(geom, entry.aabb);
+			for(int axis = 0; axis < 3; axis++)
+			{
+				dReal center = (entry.aabb[axis*2] + entry.aabb[axis*2+1]) / 2;
+				if(center < low[axis])
+					low[axis] = center;
+				if(center > high[axis])
+					high[axis] = center;
+			}
+		}
+	}
+	sweepEntries.resize(used);
+
+	int axis = 0;
+	for(int i = 1; i < 3; i++)
+	{
+		if(high[i] - low[i] > high[axis] - low[axis])
+			axis = i;
+	}
+	int axis1 = (axis + 1) % 3;
+	int axis2 = (axis + 2) % 3;
+
+	std::sort(sweepEntries.begin(), sweepEntries.end(), SweepLess(axis));
+
+	for(int i = 0; i < used; i++)
+	{
+		const SweepEntry& a = sweepEntries[i];
+		bool aAsleep = sweepAsleep(a.geom);
+		unsigned long aCategory = dGeomGetCategoryBits(a.geom);
+		unsigned long aCollide = dGeomGetCollideBits(a.geom);
+		for(int j = i + 1; j < used; j++)
+		{
+			const SweepEntry& b = sweepEntries[j];
+			if(b.aabb[axis*2] > a.aabb[axis*2+1])
+				break;
+			if(b.aabb[axis1*2] > a.aabb[axis1*2+1] || a.aabb[axis1*2] > b.aabb[axis1*2+1])
+				continue;
+			if(b.aabb[axis2*2] > a.aabb[axis2*2+1] || a.aabb[axis2*2] > b.aabb[axis2*2+1])
+				continue;
+			// The lane's own space already found this one
+			if(acrossLanes && a.lane == b.lane)
+				continue;
+			// Nothing can move between two resting or anchored parts
+			if(aAsleep && sweepAsleep(b.geom))
+				continue;
+			if(!(aCategory & dGeomGetCollideBits(b.geom)) && !(aCollide & dGeomGetCategoryBits(b.geom)))
+				continue;
+			collisionCallback(this, a.geom, b.geom);
+		}
+	}
+}
+
+void XplicitNgine::updateBody(PartInstance *partInstance)
+{
+	if(recorder != NULL && partInstance->physGeom[0] != NULL)
+		recorder->recordMove(partInstance);
+	placeBody(partInstance);
+}
+
+void XplicitNgine::placeBody(PartInstance *partInstance)
+{
+	dGeomID geom = partInstance->physGeom[0];
+	if(geom == NULL)
+		return;
+	if(partInstance->physRoot != NULL)
+	{
+		// Moving one member by hand breaks its welds
+		dissolveAssembly(partInstance->physRoot, partInstance);
+		refreshBody(partInstance);
+		return;
+	}
+
+	Vector3 position = partInstance->getCFrame().translation;
+	dMatrix3 rotation;
+	toODERotation(partInstance->getCFrame().rotation, rotation);
+
+	if(partInstance->physBody != NULL)
+	{
+		dBodySetPosition(partInstance->physBody, 
+			position[0],
+			position[1],
+			position[2]
+		);
+		dBodySetRotation(partInstance->physBody, rotation);
+	}
+
+	if(dGeomGetBody(geom) != NULL)
+	{
+		wakeBody(partInstance->physBody);
+		dGeomEnable(geom);
+
+		// Moved by hand, don't interpolate from the old pose
+		if(partInstance->physActiveIndex >= 0)
+		{
+			PhysTransform& transform = activeTransforms[partInstance->physActiveIndex];
+			transform.prevCFrame = partInstance->getCFrame();
+			transform.cFrame = partInstance->getCFrame();
+		}
+	}
+	else
+	{
+		// Anchored and dragged geoms don't follow a body
+		bool indexed = staticTree.contains(geom);
+		if(indexed)
+			removeStatic(geom);
+		dGeomSetPosition(geom, position[0], position[1], position[2]);
+		dGeomSetRotation(geom, rotation);
+		if(indexed)
+			addStatic(geom);
+		touchGeom(geom);
+	}
+}
+
+namespace
+{
+	// Surface on one side of a local axis. +X is the left face.
+	Enum::SurfaceType::Value faceSurface(PartInstance* partInstance, int axis, bool positive)
+	{
+		switch(axis)
+		{
+		case 0:
+			return positive ? partInstance->left : partInstance->right;
+		case 1:
+			return positive ? partInstance->top : partInstance->bottom;
+		default:
+			return positive ? partInstance->front : partInstance->back;
+		}
+	}
+
+	bool isJointSurface(Enum::SurfaceType::Value surface)
+	{
+		return surface == Enum::SurfaceType::Hinge || surface == Enum::SurfaceType::Motor || surface == Enum::SurfaceType::StepperMotor;
+	}
+
+	bool hasBumps(PartInstance* partInstance)
+	{
+		return partInstance->top == Enum::SurfaceType::Bumps || partInstance->bottom == Enum::SurfaceType::Bumps
+			|| partInstance->left == Enum::SurfaceType::Bumps || partInstance->right == Enum::SurfaceType::Bumps
+			|| partInstance->front == Enum::SurfaceType::Bumps || partInstance->back == Enum::SurfaceType::Bumps;
+	}
+
+	// Two blocks are glued when they share a face with bumps on at least one
+	// side and a joint on neither. Only parts whose axes line up are checked,
+	// which is everything built on the grid.
+	bool isGlued(PartInstance* a, PartInstance* b)
+	{
+		const float tolerance = 0.05F;
+		CoordinateFrame cFrameA = a->getCFrame();
+		CoordinateFrame cFrameB = b->getCFrame();
+		Matrix3 relative = cFrameA.rotation.transpose() * cFrameB.rotation;
+		Vector3 offset = cFrameA.rotation.transpose() * (cFrameB.translation - cFrameA.translation);
+		Vector3 halfA = a->getSize() / 2;
+		Vector3 halfB;
+		int axisB[3];
+		bool flipped[3];
+		for(int i = 0; i < 3; i++)
+		{
+			axisB[i] = -1;
+			for(int j = 0; j < 3; j++)
+			{
+				if(fabs(relative[i][j]) > 0.99F)
+				{
+					axisB[i] = j;
+					flipped[i] = relative[i][j] < 0;
+				}
+			}
+			if(axisB[i] < 0)
+				return false;
+			halfB[i] = b->getSize()[axisB[i]] / 2;
+		}
+
+		for(int i = 0; i < 3; i++)
+		{
+			if(fabs(fabs(offset[i]) - halfA[i] - halfB[i]) > tolerance)
+				continue;
+			// Touching along this axis, the faces still have to overlap
+			int k1 = (i + 1) % 3;
+			int k2 = (i + 2) % 3;
+			if(fabs(offset[k1]) > halfA[k1] + halfB[k1] - tolerance || fabs(offset[k2]) > halfA[k2] + halfB[k2] - tolerance)
+				return false;
+			bool above = offset[i] > 0;
+			Enum::SurfaceType::Value surfaceA = faceSurface(a, i, above);
+			// b's face points back at a
+			Enum::SurfaceType::Value surfaceB = faceSurface(b, axisB[i], above == flipped[i]);
+			if(isJointSurface(surfaceA) || isJointSurface(surfaceB))
+				return false;
+			return surfaceA == Enum::SurfaceType::Bumps || surfaceB == Enum::SurfaceType::Bumps;
+		}
+		return false;
+	}
+}
+
+void XplicitNgine::buildAssemblies(const std::vector<PartInstance*>& parts)
+{
+	if(recorder != NULL)
+		recorder->recordWeld(parts);
+
+	std::vector<PartInstance*> candidates;
+	std::map<PartInstance*, int> candidateIndex;
+	AABSPTree<dGeomID> tree;
+	for(size_t i = 0; i < parts.size(); i++)
+	{
+		PartInstance* partInstance = parts[i];
+		if(partInstance->physGeom[0] == NULL || partInstance->shape != Enum::Shape::Block || partInstance->isDragging())
+			continue;
+		candidateIndex[partInstance] = (int)candidates.size();
+		candidates.push_back(partInstance);
+		tree.insert(partInstance->physGeom[0]);
+	}
+	tree.balance();
+
+	// Union everything glued together. Nothing glues without bumps, so only
+	// parts that have some go looking for neighbours.
+	std::vector<int> parents(candidates.size());
+	for(size_t i = 0; i < parents.size(); i++)
+		parents[i] = (int)i;
+	Array<dGeomID> hits;
+	for(size_t i = 0; i < candidates.size(); i++)
+	{
+		PartInstance* a = candidates[i];
+		if(!hasBumps(a))
+			continue;
+		AABox bounds;
+		getBounds(a->physGeom[0], bounds);
+		bounds = AABox(bounds.low() - Vector3(0.1F, 0.1F, 0.1F), bounds.high() + Vector3(0.1F, 0.1F, 0.1F));
+
+		hits.fastClear();
+		tree.getIntersectingMembers(bounds, hits);
+		for(int j = 0; j < hits.size(); j++)
+		{
+			PartInstance* b = (PartInstance*)dGeomGetData(hits[j]);
+			int other = candidateIndex[b];
+			// Seen from b's side already, or two anchored parts with nothing to weld
+			if(b == a || (hasBumps(b) && other < (int)i) || (a->isAnchored() && b->isAnchored()))
+				continue;
+			if(!isGlued(a, b))
+				continue;
+			int rootA = findIsland(parents, (int)i);
+			int rootB = findIsland(parents, other);
+			if(rootA < rootB)
+				parents[rootB] = rootA;
+			else if(rootB < rootA)
+				parents[rootA] = rootB;
+		}
+	}
+
+	std::vector<std::vector<PartInstance*> > groups(candidates.size());
+	for(size_t i = 0; i < candidates.size(); i++)
+		groups[findIsland(parents, (int)i)].push_back(candidates[i]);
+
+	mutationDepth++;
+	for(size_t i = 0; i < groups.size(); i++)
+	{
+		if(groups[i].size() > 1)
+			weldAssembly(groups[i]);
+	}
+	closeBatch();
+}
+
+void XplicitNgine::weldAssembly(const std::vector<PartInstance*>& parts)
+{
+	// Left alone if it's welded exactly like this from an earlier run
+	PartInstance* oldRoot = parts[0]->physRoot;
+	bool unchanged = oldRoot != NULL && oldRoot->physWelded.size() + 1 == parts.size();
+	for(size_t i = 0; i < parts.size() && unchanged; i++)
+		unchanged = parts[i]->physRoot == oldRoot;
+	if(unchanged)
+		return;
+	for(size_t i = 0; i < parts.size(); i++)
+	{
+		if(parts[i]->physRoot != NULL)
+			dissolveAssembly(parts[i]->physRoot, NULL);
+	}
+
+	PartInstance* root = NULL;
+	for(size_t i = 0; i < parts.size() && root == NULL; i++)
+	{
+		if(parts[i]->isAnchored())
+			root = parts[i];
+	}
+
+	if(root != NULL)
+	{
+		// Glued to something anchored, the whole group is held still
+		for(size_t i = 0; i < parts.size(); i++)
+		{
+			PartInstance* partInstance = parts[i];
+			partInstance->physRoot = root;
+			if(partInstance != root)
+				root->physWelded.push_back(partInstance);
+			if(partInstance->physBody == NULL)
+				continue;
+
+			dGeomID geom = partInstance->physGeom[0];
+			removeActive(partInstance);
+			dGeomSetBody(geom, NULL);
+			dSpaceRemove(dGeomGetSpace(geom), geom);
+			destroyPhysBody(partInstance);
+			partInstance->setVelocity(Vector3(0, 0, 0));
+			partInstance->setRotVelocity(Vector3(0, 0, 0));
+			addStatic(geom);
+		}
+		return;
+	}
+
+	root = parts[0];
+	dBodyID body = root->physBody;
+	CoordinateFrame rootCFrame = root->getCFrame();
+	dMass total;
+	dMassSetZero(&total);
+	for(size_t i = 0; i < parts.size(); i++)
+	{
+		CoordinateFrame local = rootCFrame.toObjectSpace(parts[i]->getCFrame());
+		dMatrix3 rotation;
+		toODERotation(local.rotation, rotation);
+		dMass mass;
+		partMass(mass, parts[i]->getSize());
+		dMassRotate(&mass, rotation);
+		dMassTranslate(&mass, local.translation.x, local.translation.y, local.translation.z);
+		dMassAdd(&total, &mass);
+	}
+
+	// ODE wants the centre of mass on the body's origin
+	CoordinateFrame bodyFrame(rootCFrame.rotation, rootCFrame.pointToWorldSpace(Vector3(total.c[0], total.c[1], total.c[2])));
+	dVector3 velocity;
+	dBodyGetPointVel(body, bodyFrame.translation.x, bodyFrame.translation.y, bodyFrame.translation.z, velocity);
+	dMassTranslate(&total, -total.c[0], -total.c[1], -total.c[2]);
+	dBodySetMass(body, &total);
+	dBodySetPosition(body, bodyFrame.translation.x, bodyFrame.translation.y, bodyFrame.translation.z);
+	dBodySetLinearVel(body, velocity[0], velocity[1], velocity[2]);
+
+	for(size_t i = 0; i < parts.size(); i++)
+	{
+		PartInstance* partInstance = parts[i];
+		partInstance->physRoot = root;
+		partInstance->physOffset = bodyFrame.toObjectSpace(partInstance->getCFrame());
+		if(partInstance != root)
+		{
+			root->physWelded.push_back(partInstance);
+			removeActive(partInstance);
+			destroyPhysBody(partInstance);
+		}
+		attachGeom(partInstance, body);
+	}
+
+	if(root->physActiveIndex >= 0)
+	{
+		PhysTransform& transform = activeTransforms[root->physActiveIndex];
+		transform.prevCFrame = bodyFrame;
+		transform.cFrame = bodyFrame;
+	}
+	wakeBody(body);
+}
+
+void XplicitNgine::dissolveAssembly(PartInstance* root, PartInstance* leaving)
+{
+	std::vector<PartInstance*> parts;
+	parts.push_back(root);
+	parts.insert(parts.end(), root->physWelded.begin(), root->physWelded.end());
+	root->physWelded.clear();
+
+	// Anchored roots hold their group still without a body
+	dBodyID body = root->physBody;
+	if(body != NULL)
+	{
+		// Hand every member its share of the body's motion before it leaves
+		CoordinateFrame bodyFrame = bodyCFrame(body);
+		const dReal* rotVelocity = dBodyGetAngularVel(body);
+		for(size_t i = 0; i < parts.size(); i++)
+		{
+			PartInstance* partInstance = parts[i];
+			if(partInstance == leaving)
+				continue;
+			CoordinateFrame cFrame = bodyFrame * partInstance->physOffset;
+			dVector3 velocity;
+			dBodyGetPointVel(body, cFrame.translation.x, cFrame.translation.y, cFrame.translation.z, velocity);
+			partInstance->setCFrameNoSync(cFrame);
+			partInstance->setVelocity(Vector3(velocity[0], velocity[1], velocity[2]));
+			partInstance->setRotVelocity(Vector3(rotVelocity[0], rotVelocity[1], rotVelocity[2]));
+		}
+	}
+
+	mutationDepth++;
+	for(size_t i = 0; i < parts.size(); i++)
+	{
+		PartInstance* partInstance = parts[i];
+		partInstance->physRoot = NULL;
+		partInstance->physOffset = CoordinateFrame();
+		if(body != NULL && partInstance != root)
+			dGeomSetBody(partInstance->physGeom[0], NULL);
+	}
+	if(body != NULL)
+		dGeomClearOffset(root->physGeom[0]);
+
+	// The leaving part is taken care of by whoever is removing it
+	for(size_t i = 0; i < parts.size(); i++)
+	{
+		if(parts[i] != leaving && !parts[i]->isAnchored())
+			refreshBody(parts[i]);
+	}
+	closeBatch();
+}
+
+void XplicitNgine::attachGeom(PartInstance* partInstance, dBodyID body)
+{
+	dGeomID geom = partInstance->physGeom[0];
+	dGeomSetBody(geom, body);
+	// Static geoms stay in the static tree
+	if(dGeomGetSpace(geom) != NULL)
+		setGeomLane(geom, ((PartInstance*)dBodyGetData(body))->physLane);
+	if(partInstance->physRoot != NULL)
+	{
+		const CoordinateFrame& offset = partInstance->physOffset;
+		dMatrix3 rotation;
+		toODERotation(offset.rotation, rotation);
+		dGeomSetOffsetPosition(geom, offset.translation.x, offset.translation.y, offset.translation.z);
+		dGeomSetOffsetRotation(geom, rotation);
+	}
+}
+
+void XplicitNgine::syncAssembly(PartInstance* root, const PhysTransform& transform)
+{
+	dBodyID body = root->physBody;
+	for(size_t i = 0; i <= root->physWelded.size(); i++)
+	{
+		PartInstance* partInstance = i == 0 ? root : root->physWelded[i-1];
+		CoordinateFrame cFrame = transform.cFrame * partInstance->physOffset;
+		dVector3 velocity;
+		dBodyGetPointVel(body, cFrame.translation.x, cFrame.translation.y, cFrame.translation.z, velocity);
+		partInstance->setVelocity(Vector3(velocity[0], velocity[1], velocity[2]));
+		partInstance->setRotVelocity(transform.rotVelocity);
+		partInstance->setCFrameNoSync(cFrame);
+	}
+}
+
+void XplicitNgine::queueBody(PartInstance* partInstance)
+{
+	if(!partInstance->physQueued && partInstance->physGeom[0] == NULL)
+	{
+		if(recorder != NULL)
+			recorder->recordQueue(partInstance);
+		partInstance->physQueued = true;
+		queuedParts.push_back(partInstance);
+	}
+}
+
+void XplicitNgine::dequeueBody(PartInstance* partInstance)
+{
+	if(partInstance->physQueued)
+	{
+		partInstance->physQueued = false;
+		queuedParts.erase(std::remove(queuedParts.begin(), queuedParts.end(), partInstance), queuedParts.end());
+	}
+}
+
+void XplicitNgine::createQueuedBodies()
+{
+	// addBody dequeues each part, so work from a local copy
+	std::vector<PartInstance*> toCreate;
+	toCreate.swap(queuedParts);
+	if(toCreate.empty())
+		return;
+	if(recorder != NULL)
+		recorder->recordCreateQueued(toCreate);
+	RealTime start = System::time();
+	for(size_t i = 0; i < toCreate.size(); i++)
+	{
+		toCreate[i]->physQueued = false;
+		addBody(toCreate[i]);
+	}
+	pendingStats.createTime += (System::time() - start) * 1000;
+}
+
+void XplicitNgine::wakeBody(dBodyID body)
+{
+	dBodyEnable(body);
+	PartInstance* partInstance = (PartInstance*)dBodyGetData(body);
+	if(partInstance != NULL && !partInstance->isAnchored() && !partInstance->isDragging())
+		addActive(partInstance);
+}
+
+void XplicitNgine::addActive(PartInstance* partInstance)
+{
+	if(partInstance->physActiveIndex < 0)
+	{
+		partInstance->physActiveIndex = (int)activeParts.size();
+		partInstance->physIdleSteps = 0;
+		activeParts.push_back(partInstance);
+		// An assembly's body sits at its centre of mass, not on the root part
+		PhysTransform transform;
+		transform.prevCFrame = bodyCFrame(partInstance->physBody);
+		transform.cFrame = transform.prevCFrame;
+		activeTransforms.push_back(transform);
+	}
+}
+
+void XplicitNgine::removeActive(PartInstance* partInstance)
+{
+	int index = partInstance->physActiveIndex;
+	if(index < 0)
+		return;
+
+	// Swap with the last entry so the arrays stay packed
+	int last = (int)activeParts.size() - 1;
+	if(index != last)
+	{
+		activeParts[index] = activeParts[last];
+		activeTransforms[index] = activeTransforms[last];
+		activeParts[index]->physActiveIndex = index;
+	}
+	activeParts.pop_back();
+	activeTransforms.pop_back();
+	partInstance->physActiveIndex = -1;
+}
+
+const std::vector<PartInstance*>& XplicitNgine::getActiveParts()
+{
+	return activeParts;
+}
+
+void XplicitNgine::syncBodies()
+{
+	// Copy every awake body out of ODE in one pass
+	for(size_t i = 0; i < activeParts.size(); i++)
+	{
+		PhysTransform& transform = activeTransforms[i];
+		dBodyID body = activeParts[i]->physBody;
+
+		const dReal* velocity = dBodyGetLinearVel(body);
+		const dReal* rotVelocity = dBodyGetAngularVel(body);
+		transform.velocity = Vector3(velocity[0],velocity[1],velocity[2]);
+		transform.rotVelocity = Vector3(rotVelocity[0],rotVelocity[1],rotVelocity[2]);
+		transform.cFrame = bodyCFrame(body);
+	}
+
+	// Hand the results to the parts, dropping bodies ODE has put to sleep.
+	// A sleeping body gets its final transform before it leaves the set.
+	size_t i = 0;
+	while(i < activeParts.size())
+	{
+		PartInstance* partInstance = activeParts[i];
+		const PhysTransform& transform = activeTransforms[i];
+		if(partInstance->physRoot != NULL)
+			syncAssembly(partInstance, transform);
+		else
+		{
+			partInstance->setVelocity(transform.velocity);
+			partInstance->setRotVelocity(transform.rotVelocity);
+			partInstance->setCFrameNoSync(transform.cFrame);
+		}
+
+		if(!dBodyIsEnabled(partInstance->physBody))
+			removeActive(partInstance);
+		else
+			i++;
+	}
+}
+
+void XplicitNgine::capturePrevious()
+{
+	for(size_t i = 0; i < activeParts.size(); i++)
+		activeTransforms[i].prevCFrame = bodyCFrame(activeParts[i]->physBody);
+}
+
+int XplicitNgine::advance(double dt)
+{
+	applyQuality();
+	// Cheaper levels can also give up on catching up sooner
+	int maxSteps = maxCatchUpSteps;
+	if(governSteps)
+		maxSteps = qualityValue(minStepsPerFrame, maxCatchUpSteps);
+	if(maxSteps < 1)
+		maxSteps = 1;
+
+	accumulator += dt * timeScale;
+	int steps = (int)(accumulator / fixedStepSize);
+	if(steps > maxSteps)
+	{
+		// Too far behind to catch up, drop the backlog instead of stalling every frame after this one
+		steps = maxSteps;
+		accumulator = steps * fixedStepSize;
+	}
+	if(recorder != NULL)
+		recorder->recordAdvance(dt, steps);
+
+	RealTime frameStart = System::time();
+	RealTime syncTime = 0;
+	for(int i = 0; i < steps; i++)
+	{
+		if(i == steps - 1)
+		{
+			RealTime start = System::time();
+			capturePrevious();
+			syncTime += System::time() - start;
+		}
+		step(fixedStepSize);
+		accumulator -= fixedStepSize;
+	}
+
+	if(steps > 0)
+	{
+		RealTime start = System::time();
+		syncBodies();
+		syncTime += System::time() - start;
+	}
+	pendingStats.syncTime += syncTime * 1000;
+	finishFrame(steps);
+	if(steps > 0)
+		governQuality((System::time() - frameStart) * 1000);
+	return steps;
+}
+
+int XplicitNgine::qualityValue(int low, int high)
+{
+	if(high < low)
+		high = low;
+	return low + (high - low) * qualityLevel / (qualityLevels - 1);
+}
+
+void XplicitNgine::applyQuality()
+{
+	int iterations = qualityValue(minIterations, maxIterations);
+	if(iterations < 1)
+		iterations = 1;
+	if(iterations != solverIterations)
+	{
+		solverIterations = iterations;
+		for(size_t i = 0; i < lanes.size(); i++)
+			dWorldSetQuickStepNumIterations(lanes[i].world, solverIterations);
+	}
+
+	contactsPerPair = qualityValue(minContacts, maxContacts);
+	if(contactsPerPair < 1)
+		contactsPerPair = 1;
+	if(contactsPerPair > maxPairContacts)
+		contactsPerPair = maxPairContacts;
+}
+
+void XplicitNgine::governQuality(double frameTime)
+{
+	if(stepBudget <= 0)
+		return;
+
+	// Smooth out single slow frames, and let a change settle before judging it
+	if(governedFrames == 0 && governedTime == 0)
+		governedTime = frameTime;
+	governedTime = governedTime * 0.8 + frameTime * 0.2;
+	governedFrames++;
+
+	// Drop quickly when over budget, climb back slowly once well under it
+	if(governedTime > stepBudget && qualityLevel > 0 && governedFrames >= 5)
+		setQualityLevel(qualityLevel - 1);
+	else if(governedTime < stepBudget * 0.5 && qualityLevel < qualityLevels - 1 && governedFrames >= 60)
+		setQualityLevel(qualityLevel + 1);
+}
+
+void XplicitNgine::setQualityLevel(int level)
+{
+	if(level < 0)
+		level = 0;
+	if(level > qualityLevels - 1)
+		level = qualityLevels - 1;
+	if(level == qualityLevel)
+		return;
+	if(recorder != NULL)
+		recorder->recordQuality(level);
+	qualityLevel = level;
+	governedFrames = 0;
+	applyQuality();
+}
+
+int XplicitNgine::getQualityLevel()
+{
+	return qualityLevel;
+}
+
+void XplicitNgine::finishFrame(int steps)
+{
+	pendingStats.steps = steps;
+	pendingStats.qualityLevel = qualityLevel;
+	pendingStats.solverIterations = solverIterations;
+	pendingStats.contactsPerPair = contactsPerPair;
+
+	// Welded members share their root's body and dragged parts park theirs,
+	// so every other body is either an active root or asleep
+	int bodies = 0;
+	for(size_t i = 0; i < lanes.size(); i++)
+		bodies += lanes[i].bodyCount;
+	pendingStats.awakeBodies = (int)activeParts.size();
+	pendingStats.sleepingBodies = bodies - pendingStats.awakeBodies - draggedBodies;
+	stepStats.awakeBodies = pendingStats.awakeBodies;
+	stepStats.sleepingBodies = pendingStats.sleepingBodies;
+
+	frameStats = pendingStats;
+	pendingStats = PhysStats();
+	// About a minute at 30fps
+	statsHistory.push_back(frameStats);
+	if(statsHistory.size() > 1800)
+		statsHistory.pop_front();
+}
+
+const PhysStats& XplicitNgine::getStepStats()
+{
+	return stepStats;
+}
+
+const PhysStats& XplicitNgine::getFrameStats()
+{
+	return frameStats;
+}
+
+bool XplicitNgine::dumpStats(const std::string& filename, bool json)
+{
+	FILE* file = fopen(filename.c_str(), "w");
+	if(file == NULL)
+		return false;
+
+	if(json)
+		fprintf(file, "{\"frames\": [\n");
+	else
+		fprintf(file, "frame,steps,broadphase_ms,narrowphase_ms,solver_ms,sync_ms,create_ms,delete_ms,rebuild_ms,pairs,contacts,awake,sleeping,created,deleted,quality,iterations,contacts_per_pair\n");
+	for(size_t i = 0; i < statsHistory.size(); i++)
+	{
+		const PhysStats& stats = statsHistory[i];
+		if(json)
+		{
+			fprintf(file, "\t{\"frame\": %u, \"steps\": %d, \"broadphaseMs\": %.4f, \"narrowphaseMs\": %.4f, \"solverMs\": %.4f, \"syncMs\": %.4f, "
+				"\"createMs\": %.4f, \"deleteMs\": %.4f, \"rebuildMs\": %.4f, \"pairs\": %d, \"contacts\": %d, "
+				"\"awake\": %d, \"sleeping\": %d, \"created\": %d, \"deleted\": %d, "
+				"\"quality\": %d, \"iterations\": %d, \"contactsPerPair\": %d}%s\n",
+				(unsigned int)i, stats.steps, stats.broadphaseTime, stats.narrowphaseTime, stats.solverTime, stats.syncTime,
+				stats.createTime, stats.deleteTime, stats.rebuildTime, stats.pairs, stats.contacts,
+				stats.awakeBodies, stats.sleepingBodies, stats.bodiesCreated, stats.bodiesDeleted,
+				stats.qualityLevel, stats.solverIterations, stats.contactsPerPair,
+				i + 1 < statsHistory.size() ? "," : "");
+		}
+		else
+		{
+			fprintf(file, "%u,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%d,%d,%d,%d,%d,%d,%d,%d,%d\n",
+				(unsigned int)i, stats.steps, stats.broadphaseTime, stats.narrowphaseTime, stats.solverTime, stats.syncTime,
+				stats.createTime, stats.deleteTime, stats.rebuildTime, stats.pairs, stats.contacts,
+				stats.awakeBodies, stats.sleepingBodies, stats.bodiesCreated, stats.bodiesDeleted,
+				stats.qualityLevel, stats.solverIterations, stats.contactsPerPair);
+		}
+	}
+	if(json)
+		fprintf(file, "]}\n");
+	fclose(file);
+	return true;
+}
+
+void XplicitNgine::interpolate()
+{
+	// Render one step behind, blended by how far we are into the next one
+	float alpha = (float)(accumulator / fixedStepSize);
+	if(alpha > 1)
+		alpha = 1;
+	for(size_t i = 0; i < activeParts.size(); i++)
+	{
+		const PhysTransform& transform = activeTransforms[i];
+		PartInstance* partInstance = activeParts[i];
+		CoordinateFrame cFrame = transform.prevCFrame.lerp(transform.cFrame, alpha);
+		if(partInstance->physRoot != NULL)
+		{
+			partInstance->setRenderCFrame(cFrame * partInstance->physOffset);
+			for(size_t j = 0; j < partInstance->physWelded.size(); j++)
+				partInstance->physWelded[j]->setRenderCFrame(cFrame * partInstance->physWelded[j]->physOffset);
+		}
+		else
+			partInstance->setRenderCFrame(cFrame);
+	}
+}
@@ -47,6 +47,9 @@ DataModelManager::DataModelManager(void)
 	_loadedFileName="..//skooter.rbxm";
 	listicon = 5;
 	running = false;
+	for(int i = 0; i < 32; i++)
+		groupMasks[i] = 0xFFFFFFFF;
+	physicsBudget = 0;
 	xplicitNgine = NULL;
 	resetEngine();
 }
@@ -57,13 +60,40 @@ void DataModelManager::resetEngine()
 		delete xplicitNgine;
 	xplicitNgine = new XplicitNgine();
 	g_xplicitNgine = xplicitNgine;
+	xplicitNgine->stepBudget = physicsBudget;
+	for(int i = 0; i < 32; i++)
+	{
+		for(int j = i; j < 32; j++)
+		{
+			bool collide = (groupMasks[i] & (1UL << j)) && (groupMasks[j] & (1UL << i));
+			if(!collide)
+				xplicitNgine->setGroupsCollide(i, j, false);
+		}
+	}
 	for(size_t i = 0; i < getWorkspace()->partObjects.size(); i++)
 	{
 		PartInstance* partInstance = getWorkspace()->partObjects[i];
 		partInstance->physBody = NULL;
+		partInstance->physGeom[0] = partInstance->physGeom[1] = partInstance->physGeom[2] = NULL;
+		partInstance->physActiveIndex = -1;
+		partInstance->physQueued = false;
+		partInstance->physDirty = false;
+		partInstance->physLane = 0;
+		partInstance->physIdleSteps = 0;
+		partInstance->physDragged = false;
+		partInstance->physRoot = NULL;
+		partInstance->physWelded.clear();
+		partInstance->physOffset = CoordinateFrame();
+		xplicitNgine->queueBody(partInstance);
 	}
 }
 
+void DataModelManager::setPhysicsBudget(float budget)
+{
+	physicsBudget = budget;
+	xplicitNgine->stepBudget = budget;
+}
+
 XplicitNgine * DataModelManager::getEngine()
 {
 	return xplicitNgine;
@@ -72,6 +102,12 @@ XplicitNgine * DataModelManager::getEngine()
 void DataModelManager::toggleRun()
 {
 	running = !running;
+	if(running)
+	{
+		// Weld glued parts before the first step
+		xplicitNgine->createQueuedBodies();
+		xplicitNgine->buildAssemblies(getWorkspace()->partObjects);
+	}
 	//if(!running)
 		//resetEngine();
 }
@@ -84,6 +120,8 @@ bool DataModelManager::isRunning()
 DataModelManager::~DataModelManager(void)
 {
 	delete xplicitNgine;
+	// Parts are destroyed after this, they must not reach the old engine
+	g_xplicitNgine = NULL;
 }
 
 #ifdef _DEBUG
@@ -108,7 +146,11 @@ void DataModelManager::clearLevel()
 	}
 	selectionService->clearSelection();
 	selectionService->addSelected(this);
+	for(int i = 0; i < 32; i++)
+		groupMasks[i] = 0xFFFFFFFF;
+	xplicitNgine->beginMutations();
 	workspace->clearChildren();
+	xplicitNgine->commitMutations();
 }
 PartInstance* DataModelManager::makePart()
 {
@@ -147,6 +189,48 @@ float DataModelManager::getFloatValue(xml_node<> * node,const char* name)
 	return newFloat;
 }
 
+rapidxml::xml_node<>* DataModelManager::getProperty(xml_node<> * itemNode,const char* name)
+{
+	xml_node<> * propNode = itemNode->first_node("Properties");
+	if (!propNode)
+		return 0;
+	for (xml_node<> *node = propNode->first_node();node; node = node->next_sibling())
+	{
+		xml_attribute<> *nameAttr = node->first_attribute("name");
+		if (nameAttr && strcmp(nameAttr->value(), name)==0)
+			return node;
+	}
+	return 0;
+}
+
+void DataModelManager::loadCollisionGroups(const char* groups)
+{
+	// Entries of name^id^mask, split by backslashes. Groups left out keep
+	// touching everything.
+	std::string entries = groups;
+	std::size_t start = 0;
+	while (start < entries.length())
+	{
+		std::size_t end = entries.find('\\', start);
+		if (end == std::string::npos)
+			end = entries.length();
+		std::string entry = entries.substr(start, end - start);
+		start = end + 1;
+
+		std::size_t idStart = entry.find('^');
+		if (idStart == std::string::npos)
+			continue;
+		std::size_t maskStart = entry.find('^', idStart + 1);
+		if (maskStart == std::string::npos)
+			continue;
+		int id = atoi(entry.substr(idStart + 1, maskStart - idStart - 1).c_str());
+		if (id < 0 || id > 31)
+			continue;
+		// Masks are often saved signed; strtoul reads -1 as all bits set
+		groupMasks[id] = strtoul(entry.substr(maskStart + 1).c_str(), NULL, 10);
+	}
+}
+
 
 Color3 bcToRGB(short bc)
 {
@@ -301,22 +385,37 @@ Color3 bcToRGB(short bc)
 
 
 
-bool DataModelManager::scanXMLObject(xml_node<> * scanNode)
+bool DataModelManager::scanXMLObject(xml_node<> * scanNode, int collisionGroup)
 {
 	xml_node<> * watchFirstNode = scanNode->first_node();
 
 	for (xml_node<> *node = scanNode->first_node();node; node = node->next_sibling())
 	{
+		int childGroup = collisionGroup;
 
 		if (strncmp(node->name(),"Item",4)==0)
 		{
 			xml_attribute<> *classAttr = node->first_attribute("class");
 			std::string className = classAttr->value();
-			if (className=="Part") {
+			if (className=="Workspace") {
+				xml_node<> *groupsNode = getProperty(node,"CollisionGroups");
+				if (groupsNode)
+					loadCollisionGroups(groupsNode->value());
+			}
+			else if (className=="Model") {
+				// Models aren't kept, so their group goes straight to every part
+				// inside. An outer model's group wins, as it would in the editor.
+				xml_node<> *groupNode = getProperty(node,"CollisionGroup");
+				if (groupNode && collisionGroup < 0)
+					childGroup = atoi(groupNode->value());
+			}
+			else if (className=="Part") {
 				xml_node<> *propNode = node->first_node();
 				xml_node<> *cFrameNode=0;
 				xml_node<> *sizeNode=0;
 				xml_node<> *anchoredNode=0;
+				xml_node<> *canCollideNode=0;
+				xml_node<> *collisionGroupNode=0;
 				xml_node<> *shapeNode=0;
 				xml_node<> *colorNode=0;
 				xml_node<> *brickColorNode=0;
@@ -337,6 +436,14 @@ bool DataModelManager::scanXMLObject(xml_node<> * scanNode)
 						{
 							 anchoredNode = partPropNode;
 						}
+						if (xmlValue=="CanCollide")
+						{
+							 canCollideNode = partPropNode;
+						}
+						if (xmlValue=="CollisionGroup")
+						{
+							 collisionGroupNode = partPropNode;
+						}
 						if (xmlValue=="Name")
 						{
 							 nameNode = partPropNode;
@@ -451,6 +558,18 @@ bool DataModelManager::scanXMLObject(xml_node<> * scanNode)
 					{
 						test->setAnchored(stricmp(anchoredNode->value(), "true") == 0);
 					}
+					if(canCollideNode)
+					{
+						test->setCanCollide(stricmp(canCollideNode->value(), "true") == 0);
+					}
+					if(collisionGroup >= 0)
+					{
+						test->setCollisionGroup(collisionGroup);
+					}
+					else if(collisionGroupNode)
+					{
+						test->setCollisionGroup(atoi(collisionGroupNode->value()));
+					}
 					test->setSize(Vector3(sizeX,sizeY+_modY,sizeZ));
 					test->setName(newName);
 					CoordinateFrame cf;
@@ -483,7 +602,7 @@ bool DataModelManager::scanXMLObject(xml_node<> * scanNode)
 			std::string xmlValue = attr->value();
 		}
 		*/
-		scanXMLObject(node);
+		scanXMLObject(node, childGroup);
 	}
 
 	return true;
@@ -1,6 +1,7 @@
 #include "util/stdafx.h"
 
 #include "V2DataModel/Group.h"
+#include "Globals.h"
 
 GroupInstance::GroupInstance(void)
 {
@@ -9,6 +10,8 @@ GroupInstance::GroupInstance(void)
 	className = "GroupInstance";
 	listicon = 12;
 	primaryPart = NULL;
+	renderWorkspace = NULL;
+	collisionGroup = 0;
 }
 
 GroupInstance::GroupInstance(const GroupInstance &oinst)
@@ -18,20 +21,79 @@ GroupInstance::GroupInstance(const GroupInstance &oinst)
 	className = "GroupInstance";
 	listicon = 12;
 	primaryPart = NULL;
+	renderWorkspace = NULL;
+	collisionGroup = oinst.collisionGroup;
 }
 
 GroupInstance::~GroupInstance(void)
 {
+	if(renderWorkspace != NULL)
+		renderWorkspace->removeGroup(this);
 }
 
+void GroupInstance::setParent(Instance* prnt)
+{
+	if(renderWorkspace != NULL)
+		renderWorkspace->removeGroup(this);
+	Instance::setParent(prnt);
+	Instance * cparent = getParent();
+	while(cparent != NULL)
+	{
+		if(WorkspaceInstance* workspace = dynamic_cast<WorkspaceInstance*>(cparent))
+		{
+			workspace->addGroup(this);
+			break;
+		}
+		cparent = cparent->getParent();
+	}
+}
+
+void GroupInstance::setCollisionGroup(int group)
+{
+	if(group < 0)
+		group = 0;
+	if(group > 31)
+		group = 31;
+	collisionGroup = group;
+
+	// One rebuild pass for the whole model
+	if(g_xplicitNgine != NULL)
+		g_xplicitNgine->beginMutations();
+	std::vector<Instance *> descendants = getAllChildren();
+	for(size_t i = 0; i < descendants.size(); i++)
+	{
+		if(PartInstance* part = dynamic_cast<PartInstance*>(descendants[i]))
+			part->setCollisionGroup(group);
+	}
+	if(g_xplicitNgine != NULL)
+		g_xplicitNgine->commitMutations();
+}
+
+int GroupInstance::getCollisionGroup()
+{
+	return collisionGroup;
+}
+
+char groupCollisionGroupTxt[12];
 std::vector<PROPGRIDITEM> GroupInstance::getProperties()
 {
 	std::vector<PROPGRIDITEM> properties = PVInstance::getProperties();
+	sprintf_s(groupCollisionGroupTxt, "%d", collisionGroup);
+	properties.push_back(createPGI("Item",
+		"CollisionGroup",
+		"Collision group given to every part in the model, from 0 to 31",
+		(LPARAM)groupCollisionGroupTxt,
+		PIT_EDIT
+		));
 	return properties;
 }
 void GroupInstance::PropUpdate(LPPROPGRIDITEM &pItem)
 {
-	PVInstance::PropUpdate(pItem);
+	if(strcmp(pItem->lpszPropName, "CollisionGroup") == 0)
+	{
+		setCollisionGroup(atoi((LPSTR)pItem->lpCurValue));
+	}
+	else PVInstance::PropUpdate(pItem);
 }
 
 std::vector<Instance *> GroupInstance::unGroup()
@@ -46,6 +108,11 @@ std::vector<Instance *> GroupInstance::unGroup()
 void GroupInstance::render(RenderDevice * rd)
 {
 	Instance::render(rd);
+	renderFlag(rd);
+}
+
+void GroupInstance::renderFlag(RenderDevice * rd)
+{
 	if(primaryPart != NULL && controllerFlagShown && getControllerColor(controller) != Color3::gray())
 	{
 			rd->disableLighting();
@@ -10,6 +10,10 @@
 #include "V2DataModel/GuiRootInstance.h"
 #include "V2DataModel/ImageButtonInstance.h"
 #include "Globals.h"
+#include "BrickRenderer.h"
+#include "MeshCache.h"
+#include "LabelRenderer.h"
+#include "SelectionRenderer.h"
 #include "StringFunctions.h"
 
 #include "Listener/GUDButtonListener.h"
@@ -46,6 +50,7 @@ GuiRootInstance::GuiRootInstance() : _message(""), _messageTime(0)
 	g_fntdominant = GFont::fromFile(GetFileInPath("/content/font/dominant.fnt"));
 	g_fntlighttrek = GFont::fromFile(GetFileInPath("/content/font/lighttrek.fnt"));
 	_hideGui = false;
+	_showPhysicsStats = false;
 
 	//Bottom Left
 	TextButtonInstance* button = makeTextButton();
@@ -476,10 +481,61 @@ void GuiRootInstance::renderGUI(G3D::RenderDevice* rd, double fps)
 		g_fntdominant->draw2D(rd, _message, Vector2((rd->getWidth()/2)-(g_fntdominant->get2DStringBounds(_message, 20).x/2),(rd->getHeight()/2)-(g_fntdominant->get2DStringBounds(_message, 20).y/2)), 20, Color3::yellow(), Color3::black());
 	}
 
+	if(_showPhysicsStats)
+		drawPhysicsStats(rd);
+
 	g_dataModel->drawMessage(rd);
 	render(rd);
 }
 
+void GuiRootInstance::drawPhysicsStats(G3D::RenderDevice* rd)
+{
+	if(g_xplicitNgine == NULL)
+		return;
+	const PhysStats& stats = g_xplicitNgine->getFrameStats();
+
+	std::vector<std::string> lines;
+	std::stringstream stream;
+	stream << std::fixed << std::setprecision(2);
+	stream << "Steps: " << stats.steps << "  Pairs: " << stats.pairs << "  Contacts: " << stats.contacts;
+	lines.push_back(stream.str());
+	stream.str("");
+	stream << "Broadphase: " << stats.broadphaseTime << "ms  Narrowphase: " << stats.narrowphaseTime << "ms  Solver: " << stats.solverTime << "ms";
+	lines.push_back(stream.str());
+	stream.str("");
+	stream << "Sync: " << stats.syncTime << "ms  Create: " << stats.createTime << "ms  Delete: " << stats.deleteTime << "ms  Rebuild: " << stats.rebuildTime << "ms";
+	lines.push_back(stream.str());
+	stream.str("");
+	stream << "Awake: " << stats.awakeBodies << "  Sleeping: " << stats.sleepingBodies << "  Bodies +" << stats.bodiesCreated << " -" << stats.bodiesDeleted;
+	lines.push_back(stream.str());
+	stream.str("");
+	stream << "Quality: " << stats.qualityLevel << "/" << (XplicitNgine::qualityLevels - 1) << "  Iterations: " << stats.solverIterations << "  Contacts/pair: " << stats.contactsPerPair << "  Budget: " << g_xplicitNgine->stepBudget << "ms";
+	lines.push_back(stream.str());
+
+	WorkspaceInstance* workspace = g_dataModel->getWorkspace();
+	const RenderStats& renderStats = workspace->getBrickRenderer()->getStats();
+	stream.str("");
+	stream << "Submitted: " << workspace->getSubmittedParts() << "  Culled: " << workspace->getCulledParts() << "  Chunks: " << renderStats.chunks << "  Baked: " << renderStats.bakedParts << "  Labels: " << workspace->getLabelRenderer()->getLabelCount();
+	lines.push_back(stream.str());
+	stream.str("");
+	stream << "Draw calls: " << renderStats.drawCalls << "  Batched: " << renderStats.batchedParts << "  Unbatched: " << renderStats.legacyParts << "  Vertices: " << renderStats.vertices << "  Studs: " << renderStats.studs << "  Meshes: " << MeshCache::getMeshCount() << "/" << MeshCache::getReferenceCount();
+	lines.push_back(stream.str());
+	stream.str("");
+	stream << "LOD: " << (workspace->getBrickRenderer()->isLod() ? "on" : "off") << "  Full: " << renderStats.lodParts[0] << "  Medium: " << renderStats.lodParts[1] << "  Low: " << renderStats.lodParts[2];
+	lines.push_back(stream.str());
+	stream.str("");
+	const StateChanges& changes = renderStats.stateChanges;
+	stream << "State changes: " << changes.total() << "  Materials: " << changes.materials << "  Textures: " << changes.textures << "  Buffers: " << changes.buffers << "  Transforms: " << changes.transforms << "  Colors: " << changes.colors;
+	lines.push_back(stream.str());
+	stream.str("");
+	SelectionRenderer* selectionRenderer = g_dataModel->getSelectionService()->getSelectionRenderer();
+	stream << "Selection vertices: " << selectionRenderer->getVertexCount() << "  Rebuilds: " << selectionRenderer->getBuildCount();
+	lines.push_back(stream.str());
+
+	for(size_t i = 0; i < lines.size(); i++)
+		g_fntdominant->draw2D(rd, lines[i], Vector2(120, 45 + i * 14.0F), 10, Color3::fromARGB(0xFFFF00), Color3::black());
+}
+
 bool GuiRootInstance::mouseInGUI(G3D::RenderDevice* renderDevice,int x,int y)
 {
 	std::vector<Instance*> instances_2D = g_dataModel->getGuiRoot()->getAllChildren();
@@ -553,4 +609,12 @@ void GuiRootInstance::onMouseLeftUp(G3D::RenderDevice* renderDevice, int x,int y
 
 void GuiRootInstance::hideGui(bool doHide) {
 	_hideGui = doHide;
+}
+
+void GuiRootInstance::showPhysicsStats(bool doShow) {
+	_showPhysicsStats = doShow;
+}
+
+bool GuiRootInstance::isShowingPhysicsStats() {
+	return _showPhysicsStats;
 }
\ No newline at end of file
@@ -13,10 +13,27 @@ PartInstance::PartInstance(void)
 {
 	PVInstance::PVInstance();
 	physBody = NULL;
-    glList = glGenLists(1);
+	physGeom[0] = physGeom[1] = physGeom[2] = NULL;
+	physActiveIndex = -1;
+	physQueued = false;
+	physDirty = false;
+	physLane = 0;
+	physIdleSteps = 0;
+	physDragged = false;
+	physRoot = NULL;
+	glList = 0;
+	renderTier = 0;
+	renderChunk = -1;
+	renderMovingIndex = -1;
+	renderStillFrames = 0;
+	renderWorkspace = NULL;
+	renderQueued = false;
+	boundsChanged = false;
+	bakeChanged = false;
 	name = "Part";
 	className = "Part";
 	canCollide = true;
+	collisionGroup = 0;
 	anchored = false;
 	dragging = false;
 	size = Vector3(2,1,4);
@@ -52,7 +69,9 @@ void PartInstance::setDragging(bool value)
 	if (dragging != value)
 	{
 		dragging = value;
-		g_dataModel->getEngine()->resetBody(this);
+		markBakeChanged();
+		if(this->physGeom[0] != NULL)
+			g_xplicitNgine->resetBody(this);
 	}
 }
 
@@ -113,40 +132,10 @@ void PartInstance::postRender(RenderDevice *rd)
 	// possibly descard this function...
 }
 
-void PartInstance::renderName(RenderDevice *rd)
-{
-	if(!nameShown)
-		return;
-	G3D::GFontRef fnt = NULL;
-	Instance* dm = parent;
-	while(dm != NULL)
-	{
-		if(DataModelManager* mod = dynamic_cast<DataModelManager*>(dm))
-		{
-			fnt = mod->font;
-			break;
-		}
-		dm = dm->getParent();
-	}
-	if(!fnt.isNull())
-	{
-		Vector3 gamepoint = position + Vector3(0,1.5,0);
-		Vector3 camerapoint = rd->getCameraToWorldMatrix().translation;
-		float distance = pow(pow((double)gamepoint.x - (double)camerapoint.x, 2) + pow((double)gamepoint.y - (double)camerapoint.y, 2) + pow((double)gamepoint.z - (double)camerapoint.z, 2), 0.5);
-		if(distance < 100 && distance > -100)
-		{
-			if(distance < 0)
-			distance = distance*-1;
-			glDisable(GL_DEPTH_TEST);
-			fnt->draw3D(rd, name, CoordinateFrame(rd->getCameraToWorldMatrix().rotation, gamepoint), 0.03*distance, Color3::yellow(), Color3::black(), G3D::GFont::XALIGN_CENTER, G3D::GFont::YALIGN_CENTER);
-			glEnable(GL_DEPTH_TEST);
-		}
-	}
-}
-
 void PartInstance::setChanged()
 {
 	changed = true;
+	markBakeChanged();
 }
 
 void PartInstance::setSurface(int face, Enum::SurfaceType::Value surface)
@@ -171,21 +160,23 @@ void PartInstance::setSurface(int face, Enum::SurfaceType::Value surface)
 	default:
 		back = surface;
 	}
+	// Surfaces decide what the part is welded to
+	if(this->physGeom[0] != NULL)
+		g_xplicitNgine->resetBody(this);
 	changed = true;
+	markBakeChanged();
 }
 
 void PartInstance::setParent(Instance* prnt)
 {
-	if(this->physBody != NULL)
-	{
-		g_dataModel->getEngine()->deleteBody(this);
-	}
+	if(g_xplicitNgine != NULL)
+		g_xplicitNgine->deleteBody(this);
 	Instance * cparent = getParent();
 	while(cparent != NULL)
 	{
 		if(WorkspaceInstance* workspace = dynamic_cast<WorkspaceInstance*>(cparent))
 		{
-			workspace->partObjects.erase(std::remove(workspace->partObjects.begin(), workspace->partObjects.end(), this), workspace->partObjects.end());
+			workspace->removePart(this);
 		}
 		cparent = cparent->getParent();
 	}
@@ -195,7 +186,9 @@ void PartInstance::setParent(Instance* prnt)
 	{
 		if(WorkspaceInstance* workspace = dynamic_cast<WorkspaceInstance*>(cparent))
 		{
-			workspace->partObjects.push_back(this);
+			workspace->addPart(this);
+			if(g_xplicitNgine != NULL)
+				g_xplicitNgine->queueBody(this);
 			break;
 		}
 		cparent = cparent->getParent();
@@ -207,9 +200,26 @@ PartInstance::PartInstance(const PartInstance &oinst)
 {
 	PVInstance::PVInstance(oinst);
 	physBody = NULL;
-	glList = glGenLists(1);
+	physGeom[0] = physGeom[1] = physGeom[2] = NULL;
+	physActiveIndex = -1;
+	physQueued = false;
+	physDirty = false;
+	physLane = 0;
+	physIdleSteps = 0;
+	physDragged = false;
+	physRoot = NULL;
+	glList = 0;
+	renderTier = 0;
+	renderChunk = -1;
+	renderMovingIndex = -1;
+	renderStillFrames = 0;
+	renderWorkspace = NULL;
+	renderQueued = false;
+	boundsChanged = false;
+	bakeChanged = false;
 	name = oinst.name;
 	canCollide = oinst.canCollide;
+	collisionGroup = oinst.collisionGroup;
 	setParent(oinst.parent);
 	anchored = oinst.anchored;
 	size = oinst.size;
@@ -225,6 +235,7 @@ PartInstance::PartInstance(const PartInstance &oinst)
 	bottom = oinst.bottom;
 	shape = oinst.shape;
 	changed = true;
+	markBakeChanged();
 
 	// OnTouch
 	singleShot = oinst.singleShot;
@@ -243,6 +254,7 @@ void PartInstance::setSize(Vector3 newSize)
 	int minsize = 1;
 	int maxsize = 512;
 	changed = true;
+	markBakeChanged();
 	int sizex = (int)newSize.x;
 	if(sizex <= 0)
 		sizex = 1;
@@ -272,9 +284,10 @@ void PartInstance::setSize(Vector3 newSize)
 	}
 
 	size = Vector3(sizex, sizey, sizez);
+	markBoundsChanged();
 
-	if(this->physBody != NULL)
-		g_dataModel->getEngine()->resetBody(this);
+	if(this->physGeom[0] != NULL)
+		g_xplicitNgine->resetBody(this);
 }
 Vector3 PartInstance::getSize()
 {
@@ -295,26 +308,25 @@ void PartInstance::setShape(Enum::Shape::Value shape)
 		this->shape = shape;
 		this->setSize(this->getSize());
 	}
-	if(this->physBody != NULL)
-		g_dataModel->getEngine()->resetBody(this);
+	if(this->physGeom[0] != NULL)
+		g_xplicitNgine->resetBody(this);
 
 	changed = true;
+	markBakeChanged();
 }
 
 void PartInstance::setPosition(Vector3 pos)
 {
 	position = pos;
 	setCFrame(CoordinateFrame(cFrame.rotation, pos));
-
-	if (anchored)
-		g_dataModel->getEngine()->resetBody(this);
 }
 
 void PartInstance::setAnchored(bool anchored)
 {
 	this->anchored = anchored;
-	if(this->physBody != NULL)
-		g_dataModel->getEngine()->resetBody(this);
+	if(this->physGeom[0] != NULL)
+		g_xplicitNgine->resetBody(this);
+	markBakeChanged();
 }
 
 bool PartInstance::isAnchored()
@@ -322,6 +334,24 @@ bool PartInstance::isAnchored()
 	return this->anchored;
 }
 
+void PartInstance::setCanCollide(bool canCollide)
+{
+	this->canCollide = canCollide;
+	if(this->physGeom[0] != NULL)
+		g_xplicitNgine->resetBody(this);
+}
+
+void PartInstance::setCollisionGroup(int group)
+{
+	if(group < 0)
+		group = 0;
+	if(group > 31)
+		group = 31;
+	collisionGroup = group;
+	if(this->physGeom[0] != NULL)
+		g_xplicitNgine->resetBody(this);
+}
+
 
 CoordinateFrame PartInstance::getCFrame()
 {
@@ -330,13 +360,46 @@ CoordinateFrame PartInstance::getCFrame()
 void PartInstance::setCFrame(CoordinateFrame coordinateFrame)
 {
 	setCFrameNoSync(coordinateFrame);
-		g_dataModel->getEngine()->updateBody(this);
+	if(g_xplicitNgine != NULL)
+		g_xplicitNgine->updateBody(this);
 }
 
 void PartInstance::setCFrameNoSync(CoordinateFrame coordinateFrame)
 {
 	cFrame = coordinateFrame;
+	renderCFrame = coordinateFrame;
 	position = coordinateFrame.translation;
+	markBoundsChanged();
+	// Only anchored parts are baked. The simulation moves the rest every
+	// frame, and they join or leave a chunk through setAnchored and
+	// setDragging.
+	if(anchored)
+		markBakeChanged();
+}
+
+void PartInstance::markBoundsChanged()
+{
+	boundsChanged = true;
+	if(renderWorkspace != NULL && !renderQueued)
+		renderWorkspace->queueChanged(this);
+}
+
+void PartInstance::markBakeChanged()
+{
+	bakeChanged = true;
+	if(renderWorkspace != NULL && !renderQueued)
+		renderWorkspace->queueChanged(this);
+}
+
+CoordinateFrame PartInstance::getRenderCFrame()
+{
+	return renderCFrame;
+}
+
+void PartInstance::setRenderCFrame(CoordinateFrame coordinateFrame)
+{
+	renderCFrame = coordinateFrame;
+	markBoundsChanged();
 }
 
 bool PartInstance::collides(PartInstance * part)
@@ -377,39 +440,52 @@ bool PartInstance::collides(Box box)
 	return CollisionDetection::fixedSolidBoxIntersectsFixedSolidBox(getBox(), box);
 }
 
-void PartInstance::render(RenderDevice* rd) {
- 	if (changed)
+GLuint PartInstance::getMeshList()
+{
+	// Looked up on first draw so parts can exist without a GL context
+ 	if (changed || glList == 0)
 	{
 		changed=false;
-		Vector3 renderSize = size/2;
-		glNewList(glList, GL_COMPILE);
-		renderShape(this->shape, renderSize, color);
-		renderSurface(TOP, this->top, renderSize, this->controller, color);
-		renderSurface(FRONT, this->front, renderSize, this->controller, color);
-		renderSurface(RIGHT, this->right, renderSize, this->controller, color);
-		renderSurface(BACK, this->back, renderSize, this->controller, color);
-		renderSurface(LEFT, this->left, renderSize, this->controller, color);
-		renderSurface(BOTTOM, this->bottom, renderSize, this->controller, color);
-		glEndList();
+		Enum::SurfaceType::Value surfaces[6];
+		surfaces[TOP] = top;
+		surfaces[BOTTOM] = bottom;
+		surfaces[LEFT] = left;
+		surfaces[RIGHT] = right;
+		surfaces[FRONT] = front;
+		surfaces[BACK] = back;
+		// Lists are shared by shape, size and surfaces, so a colour change
+		// or an edit that lands on the same mesh compiles nothing
+		MeshKey key(shape, size, surfaces, controller);
+		if(glList == 0 || !(key == meshKey))
+		{
+			if(glList != 0)
+				MeshCache::release(meshKey);
+			glList = MeshCache::acquire(key);
+			meshKey = key;
+		}
 	}
-	rd->setObjectToWorldMatrix(cFrame);
-	glCallList(glList);
+	return glList;
+}
+
+void PartInstance::render(RenderDevice* rd) {
+	GLuint list = getMeshList();
+	rd->setObjectToWorldMatrix(renderCFrame);
+	glColor(color);
+	glCallList(list);
 	postRender(rd);
 }
 
 PartInstance::~PartInstance(void)
 {
-	glDeleteLists(glList, 1);
-	/*
-	// Causes some weird ODE error
-	// Someone, please look into this
-
-	dBodyDestroy(physBody);
-	for (int i = 0; i < 3; i++) {
-		if (physGeom[i] != NULL) 
-			dGeomDestroy(physGeom[i]);
-	}
-	*/
+	if(glList != 0)
+		MeshCache::release(meshKey);
+	// Parts deleted along with their model never get setParent(NULL), and
+	// the workspace walks its lists every frame
+	if(renderWorkspace != NULL)
+		renderWorkspace->removePart(this);
+	// The engine holds raw pointers in its active and queued lists
+	if(g_xplicitNgine != NULL)
+		g_xplicitNgine->deleteBody(this);
 }
 
 char pto[512];
@@ -529,6 +605,10 @@ static Enum::Sound::Value EnumOnTouchSoundType(TCHAR* option)
 
 void PartInstance::onTouch()
 {
+	// Headless runs (the benchmark) have no level to score against
+	if(g_dataModel == NULL)
+		return;
+
 	if(singleShot && _touchedOnce)
 		return;
 
@@ -605,6 +685,14 @@ void PartInstance::PropUpdate(LPPROPGRIDITEM &item)
 	{
 		setAnchored(item->lpCurValue == TRUE);
 	}
+	else if(strcmp(item->lpszPropName, "CanCollide") == 0)
+	{
+		setCanCollide(item->lpCurValue == TRUE);
+	}
+	else if(strcmp(item->lpszPropName, "CollisionGroup") == 0)
+	{
+		setCollisionGroup(atoi((LPSTR)item->lpCurValue));
+	}
 	else if(strcmp(item->lpszPropName, "Offset") == 0)
 	{
 		std::string str = (LPTSTR)item->lpCurValue;
@@ -680,6 +768,7 @@ void PartInstance::PropUpdate(LPPROPGRIDITEM &item)
 // Crash occurs if you put a huge number in
 char changeTimerTxt[12];
 char changeScoreTxt[12];
+char collisionGroupTxt[12];
 std::vector<PROPGRIDITEM> PartInstance::getProperties()
 {
 	std::vector<PROPGRIDITEM> properties = PVInstance::getProperties();
@@ -697,6 +786,19 @@ std::vector<PROPGRIDITEM> PartInstance::getProperties()
 		(LPARAM)anchored,
 		PIT_CHECK
 		));
+	properties.push_back(createPGI("Item",
+		"CanCollide",
+		"Whether other parts bump into this one",
+		(LPARAM)canCollide,
+		PIT_CHECK
+		));
+	sprintf_s(collisionGroupTxt, "%d", collisionGroup);
+	properties.push_back(createPGI("Item",
+		"CollisionGroup",
+		"Which collision group the part is in, from 0 to 31",
+		(LPARAM)collisionGroupTxt,
+		PIT_EDIT
+		));
 	sprintf_s(pto, "%g, %g, %g", position.x, position.y, position.z);
 	properties.push_back(createPGI("Item",
 		"Offset",
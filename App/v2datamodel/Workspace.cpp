@@ -3,6 +3,12 @@
 #include "V2DataModel/Workspace.h"
 #include "Globals.h"
 #include "Application.h"
+#include "BrickRenderer.h"
+#include "LabelRenderer.h"
+#include "StringFunctions.h"
+
+// Frames a moving part has to stay put before it goes back in the part tree
+static const int settleFrames = 30;
 
 WorkspaceInstance::WorkspaceInstance(void)
 {
@@ -10,19 +16,236 @@ WorkspaceInstance::WorkspaceInstance(void)
 	name = "Workspace";
 	className = "Workspace";
 	canDelete = false;
+	brickRenderer = new BrickRenderer();
+	labelRenderer = new LabelRenderer(GetFileInPath("/content/font/dominant.fnt"));
+	partTreeEdits = 0;
+	culling = true;
+	submittedParts = 0;
+	culledParts = 0;
+}
+
+void WorkspaceInstance::detachParts()
+{
+	// Parts about to be deleted all at once don't need to take themselves out
+	for(size_t i = 0; i < partObjects.size(); i++)
+	{
+		PartInstance* part = partObjects[i];
+		part->renderWorkspace = NULL;
+		part->renderQueued = false;
+		part->renderMovingIndex = -1;
+	}
+	for(size_t i = 0; i < groupObjects.size(); i++)
+		groupObjects[i]->renderWorkspace = NULL;
+	groupObjects.clear();
 }
 
 void WorkspaceInstance::clearChildren()
 {
+	detachParts();
+	brickRenderer->clearStatic();
 	partObjects.clear();
+	changedParts.clear();
+	partTree.clear();
+	partTreeEdits = 0;
+	movingParts.clear();
 	Instance::clearChildren();
 }
 
+void WorkspaceInstance::addPart(PartInstance* part)
+{
+	partObjects.push_back(part);
+	part->renderWorkspace = this;
+	part->markBoundsChanged();
+	part->markBakeChanged();
+}
+
+void WorkspaceInstance::removePart(PartInstance* part)
+{
+	partObjects.erase(std::remove(partObjects.begin(), partObjects.end(), part), partObjects.end());
+	if(part->renderQueued)
+	{
+		changedParts.erase(std::remove(changedParts.begin(), changedParts.end(), part), changedParts.end());
+		part->renderQueued = false;
+	}
+	part->renderWorkspace = NULL;
+	brickRenderer->removeStatic(part);
+	if(partTree.contains(part))
+	{
+		partTree.remove(part);
+		partTreeEdits++;
+	}
+	removeMoving(part);
+}
+
+void WorkspaceInstance::addGroup(GroupInstance* group)
+{
+	group->renderWorkspace = this;
+	groupObjects.push_back(group);
+}
+
+void WorkspaceInstance::removeGroup(GroupInstance* group)
+{
+	groupObjects.erase(std::remove(groupObjects.begin(), groupObjects.end(), group), groupObjects.end());
+	group->renderWorkspace = NULL;
+}
+
+void WorkspaceInstance::queueChanged(PartInstance* part)
+{
+	part->renderQueued = true;
+	changedParts.push_back(part);
+}
+
+void WorkspaceInstance::addMoving(PartInstance* part)
+{
+	if(part->renderMovingIndex < 0)
+	{
+		part->renderMovingIndex = (int)movingParts.size();
+		movingParts.push_back(part);
+	}
+}
+
+void WorkspaceInstance::removeMoving(PartInstance* part)
+{
+	int index = part->renderMovingIndex;
+	if(index < 0)
+		return;
+
+	// Swap with the last entry so the list stays packed
+	int last = (int)movingParts.size() - 1;
+	if(index != last)
+	{
+		movingParts[index] = movingParts[last];
+		movingParts[index]->renderMovingIndex = index;
+	}
+	movingParts.pop_back();
+	part->renderMovingIndex = -1;
+}
+
+void WorkspaceInstance::setCulling(bool culling)
+{
+	this->culling = culling;
+}
+
+bool WorkspaceInstance::isCulling()
+{
+	return culling;
+}
+
+int WorkspaceInstance::getSubmittedParts()
+{
+	return submittedParts;
+}
+
+int WorkspaceInstance::getCulledParts()
+{
+	return culledParts;
+}
+
+void WorkspaceInstance::updatePartTree()
+{
+	for(size_t i = 0; i < changedParts.size(); i++)
+	{
+		PartInstance* part = changedParts[i];
+		part->renderQueued = false;
+		if(part->bakeChanged)
+		{
+			part->bakeChanged = false;
+			brickRenderer->updateStatic(part);
+		}
+		if(!part->boundsChanged)
+			continue;
+		part->boundsChanged = false;
+		part->renderStillFrames = 0;
+		if(part->renderMovingIndex >= 0)
+			continue;
+		// New parts go straight in, parts already placed start moving
+		if(partTree.contains(part))
+		{
+			partTree.remove(part);
+			addMoving(part);
+		}
+		else
+			partTree.insert(part);
+		partTreeEdits++;
+	}
+	changedParts.clear();
+
+	for(size_t i = 0; i < movingParts.size();)
+	{
+		PartInstance* part = movingParts[i];
+		if(++part->renderStillFrames < settleFrames)
+		{
+			i++;
+			continue;
+		}
+		removeMoving(part);
+		partTree.insert(part);
+		partTreeEdits++;
+	}
+
+	if(partTreeEdits * 8 > partTree.size())
+	{
+		partTree.balance();
+		partTreeEdits = 0;
+	}
+}
+
 void WorkspaceInstance::zoomToExtents()
 {
 	g_usableApp->cameraController.zoomExtents();
 }
 
+void WorkspaceInstance::render(RenderDevice * rd)
+{
+	updatePartTree();
+	// Kept for the label pass even with culling off
+	clipPlanes.fastClear();
+	g_usableApp->cameraController.getCamera()->getClipPlanes(rd->getViewport(), clipPlanes);
+	if(culling)
+	{
+		visibleMembers.fastClear();
+		partTree.getIntersectingMembers(clipPlanes, visibleMembers);
+		visibleParts.resize(visibleMembers.size());
+		for(int i = 0; i < visibleMembers.size(); i++)
+			visibleParts[i] = visibleMembers[i];
+		for(size_t i = 0; i < movingParts.size(); i++)
+		{
+			AABox bounds;
+			getBounds(movingParts[i], bounds);
+			if(!bounds.culledBy(clipPlanes))
+				visibleParts.push_back(movingParts[i]);
+		}
+		brickRenderer->render(rd, visibleParts, &clipPlanes);
+	}
+	else
+		brickRenderer->render(rd, partObjects);
+	submittedParts = culling ? (int)visibleParts.size() : (int)partObjects.size();
+	culledParts = (int)partObjects.size() - submittedParts;
+	renderFlag(rd);
+	for(size_t i = 0; i < groupObjects.size(); i++)
+		groupObjects[i]->renderFlag(rd);
+}
+
+void WorkspaceInstance::renderName(RenderDevice * rd)
+{
+	// Only parts that survived culling this frame. A label hanging into view
+	// over a part just outside it is dropped with the part.
+	labelRenderer->render(rd, culling ? visibleParts : partObjects, clipPlanes);
+}
+
+BrickRenderer* WorkspaceInstance::getBrickRenderer()
+{
+	return brickRenderer;
+}
+
+LabelRenderer* WorkspaceInstance::getLabelRenderer()
+{
+	return labelRenderer;
+}
+
 WorkspaceInstance::~WorkspaceInstance(void)
 {
+	detachParts();
+	delete brickRenderer;
+	delete labelRenderer;
 }
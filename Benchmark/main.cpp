@@ -0,0 +1,521 @@
+// Headless physics benchmark. Builds a few stock scenes straight into the
+// engine (no window, no DataModel), steps each for a fixed simulated time
+// and reports step rate, step time percentiles and peak memory. -meshes
+// times the brick mesh builder instead.
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <windows.h>
+#include <psapi.h>
+#include "Globals.h"
+#include "Util/XplicitNgine.h"
+#include "Util/PhysicsRecorder.h"
+#include "BrickMeshBuilder.h"
+#include "Faces.h"
+
+typedef void (*SceneBuilder)(std::vector<PartInstance*>& parts);
+
+struct Scene
+{
+	const char* name;
+	SceneBuilder build;
+	// In the default suite, the rest only run when asked for by name
+	bool standard;
+	// In the -compare suite, which pits the broadphases against each other
+	bool compared;
+};
+
+struct Broadphase
+{
+	const char* name;
+	Enum::Broadphase::Value value;
+};
+
+static PartInstance* addPart(std::vector<PartInstance*>& parts, Vector3 size, Vector3 position, bool anchored)
+{
+	PartInstance* part = new PartInstance();
+	part->setSize(size);
+	part->setCFrame(CoordinateFrame(position));
+	part->setAnchored(anchored);
+	parts.push_back(part);
+	return part;
+}
+
+static void addBaseplate(std::vector<PartInstance*>& parts)
+{
+	addPart(parts, Vector3(512, 1, 512), Vector3(0, -0.5F, 0), true);
+}
+
+// 2x4 bricks in a running bond, four walls round a 20 stud square, 20
+// courses high. One pair of walls runs the full 20 studs and the other fits
+// between them; they swap every course, so the corners interlock and the
+// joints move two studs each course without any bricks overlapping.
+static void buildTower(std::vector<PartInstance*>& parts)
+{
+	addBaseplate(parts);
+	for(int course = 0; course < 20; course++)
+	{
+		float y = course * 1.0F + 0.5F;
+		bool frontLong = course % 2 == 0;
+		for(int i = 0; i < 5; i++)
+		{
+			float along = -8 + i * 4.0F;
+			if(frontLong)
+			{
+				addPart(parts, Vector3(4, 1, 2), Vector3(along, y, -9), false);
+				addPart(parts, Vector3(4, 1, 2), Vector3(along, y, 9), false);
+			}
+			else
+			{
+				addPart(parts, Vector3(2, 1, 4), Vector3(-9, y, along), false);
+				addPart(parts, Vector3(2, 1, 4), Vector3(9, y, along), false);
+			}
+		}
+		for(int i = 0; i < 4; i++)
+		{
+			float along = -6 + i * 4.0F;
+			if(frontLong)
+			{
+				addPart(parts, Vector3(2, 1, 4), Vector3(-9, y, along), false);
+				addPart(parts, Vector3(2, 1, 4), Vector3(9, y, along), false);
+			}
+			else
+			{
+				addPart(parts, Vector3(4, 1, 2), Vector3(along, y, -9), false);
+				addPart(parts, Vector3(4, 1, 2), Vector3(along, y, 9), false);
+			}
+		}
+	}
+}
+
+// Loose bricks dropped onto a baseplate on the stud grid
+static void buildBaseplatePile(std::vector<PartInstance*>& parts)
+{
+	addBaseplate(parts);
+	srand(1);
+	for(int i = 0; i < 1000; i++)
+	{
+		int x = (rand() % 64) - 32;
+		int z = (rand() % 64) - 32;
+		float y = 2.0F + (i / 64) * 1.5F;
+		Vector3 size = (i % 2) ? Vector3(4, 1, 2) : Vector3(2, 1, 2);
+		addPart(parts, size, Vector3((float)x, y, (float)z), false);
+	}
+}
+
+// A 1000 domino line on a long floor, with the first one tipped over
+static void buildDominoes(std::vector<PartInstance*>& parts)
+{
+	for(int i = 0; i < 4; i++)
+		addPart(parts, Vector3(512, 1, 16), Vector3(-768 + i * 512.0F, -0.5F, 0), true);
+	for(int i = 0; i < 1000; i++)
+	{
+		PartInstance* domino = addPart(parts, Vector3(1, 4, 2), Vector3(-1000 + i * 2.0F, 2, 0), false);
+		if(i == 0)
+			domino->setRotVelocity(Vector3(0, 0, -2));
+	}
+}
+
+// 5000 balls poured into a walled pit
+static void buildBallPit(std::vector<PartInstance*>& parts)
+{
+	addPart(parts, Vector3(64, 1, 64), Vector3(0, -0.5F, 0), true);
+	addPart(parts, Vector3(64, 24, 1), Vector3(0, 12, -32.5F), true);
+	addPart(parts, Vector3(64, 24, 1), Vector3(0, 12, 32.5F), true);
+	addPart(parts, Vector3(1, 24, 64), Vector3(-32.5F, 12, 0), true);
+	addPart(parts, Vector3(1, 24, 64), Vector3(32.5F, 12, 0), true);
+	for(int i = 0; i < 5000; i++)
+	{
+		int layer = i / 625;
+		float x = -29 + (i % 25) * 2.4F + (layer % 2) * 0.5F;
+		float z = -29 + ((i / 25) % 25) * 2.4F + (layer % 2) * 0.5F;
+		PartInstance* ball = addPart(parts, Vector3(2, 2, 2), Vector3(x, 2 + layer * 2.4F, z), false);
+		ball->setShape(Enum::Shape::Ball);
+	}
+}
+
+// A wall of 2x4 bricks in a running bond, 100 long and 100 courses high
+static void buildWall(std::vector<PartInstance*>& parts)
+{
+	addBaseplate(parts);
+	for(int course = 0; course < 100; course++)
+	{
+		float offset = (course % 2) * 2.0F;
+		for(int i = 0; i < 100; i++)
+			addPart(parts, Vector3(4, 1, 2), Vector3(-200 + i * 4 + offset, course + 0.5F, 0), false);
+	}
+}
+
+// Small separate stacks falling at once, lots of independent islands
+static void buildIslands(std::vector<PartInstance*>& parts)
+{
+	addBaseplate(parts);
+	for(int x = 0; x < 20; x++)
+	{
+		for(int z = 0; z < 20; z++)
+		{
+			for(int y = 0; y < 3; y++)
+				addPart(parts, Vector3(2, 1, 2), Vector3(-100 + x * 10.0F, 4 + y * 1.5F, -100 + z * 10.0F), false);
+		}
+	}
+}
+
+// Stacks of bricks glued by their bumps, knocked over. With -weld each
+// stack is one body.
+static void buildGluedStacks(std::vector<PartInstance*>& parts)
+{
+	addBaseplate(parts);
+	for(int x = 0; x < 10; x++)
+	{
+		for(int z = 0; z < 10; z++)
+		{
+			for(int y = 0; y < 8; y++)
+			{
+				PartInstance* brick = addPart(parts, Vector3(4, 1, 2), Vector3(-100 + x * 20.0F, 0.5F + y, -100 + z * 20.0F), false);
+				brick->top = Enum::SurfaceType::Bumps;
+				if(y == 7)
+					brick->setVelocity(Vector3(6, 0, 0));
+			}
+		}
+	}
+}
+
+// 10k bricks dropped in a heap, for narrowphase scaling
+static void buildPile10k(std::vector<PartInstance*>& parts)
+{
+	addBaseplate(parts);
+	for(int i = 0; i < 10000; i++)
+	{
+		int x = (i % 50) * 2 - 50;
+		int z = ((i / 50) % 50) * 2 - 50;
+		float y = 2.0F + (i / 2500) * 1.2F;
+		addPart(parts, Vector3(2, 1, 2), Vector3((float)x + (i / 2500) % 2, y, (float)z), false);
+	}
+}
+
+static const Scene scenes[] = {
+	{"tower", buildTower, true, true},
+	{"dominoes", buildDominoes, true, true},
+	{"ball-pit", buildBallPit, true, false},
+	{"wall", buildWall, true, false},
+	{"baseplate-pile", buildBaseplatePile, false, true},
+	{"islands", buildIslands, false, false},
+	{"glued-stacks", buildGluedStacks, false, false},
+	{"pile-10k", buildPile10k, false, false},
+};
+
+static const Broadphase broadphases[] = {
+	{"hash", Enum::Broadphase::Hash},
+	{"quadtree", Enum::Broadphase::QuadTree},
+	{"simple", Enum::Broadphase::Simple},
+	{"sap", Enum::Broadphase::SweepAndPrune},
+};
+
+struct SceneResult
+{
+	size_t partCount;
+	int steps;
+	// Wall clock time spent stepping, summed over the steps
+	double seconds;
+	double p50;
+	double p99;
+	// Most private memory the scene held above what the process had before
+	// it was built, in MB. Sampled after each step, since Windows' own peak
+	// can't be reset between scenes.
+	double peakMemory;
+};
+
+static double privateMemory()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PagefileUsage / (1024.0 * 1024.0);
+}
+
+static SceneResult runScene(const Scene& scene, const Broadphase& broadphase, int threads, double simSeconds, bool weld, bool alignedBoxes)
+{
+	double baseMemory = privateMemory();
+	XplicitNgine* engine = new XplicitNgine();
+	g_xplicitNgine = engine;
+	if(threads > 0)
+		engine->setThreadCount(threads);
+	engine->setBroadphase(broadphase.value);
+	engine->alignedBoxContacts = alignedBoxes;
+
+	std::vector<PartInstance*> parts;
+	scene.build(parts);
+	for(size_t i = 0; i < parts.size(); i++)
+		engine->createBody(parts[i]);
+	if(weld)
+		engine->buildAssemblies(parts);
+
+	SceneResult result;
+	result.partCount = parts.size();
+	result.steps = (int)(simSeconds / engine->fixedStepSize);
+	if(result.steps < 1)
+		result.steps = 1;
+
+	std::vector<double> stepTimes(result.steps);
+	double peakMemory = privateMemory();
+	result.seconds = 0;
+	for(int i = 0; i < result.steps; i++)
+	{
+		RealTime stepStart = System::time();
+		engine->step(engine->fixedStepSize);
+		engine->syncBodies();
+		stepTimes[i] = (System::time() - stepStart) * 1000.0;
+		result.seconds += stepTimes[i] / 1000.0;
+		// Outside the timed part of the step
+		double memory = privateMemory();
+		if(memory > peakMemory)
+			peakMemory = memory;
+	}
+	result.peakMemory = peakMemory - baseMemory;
+
+	std::sort(stepTimes.begin(), stepTimes.end());
+	result.p50 = stepTimes[stepTimes.size() / 2];
+	result.p99 = stepTimes[stepTimes.size() * 99 / 100];
+
+	for(size_t i = 0; i < parts.size(); i++)
+		delete parts[i];
+	g_xplicitNgine = NULL;
+	delete engine;
+
+	return result;
+}
+
+// Mixed bricks: mostly blocks from 1x1x1 to 8x3x8, some balls, about a
+// third studded on top and a few on the bottom too
+static void fillMeshRequests(std::vector<MeshRequest>& requests, int count)
+{
+	srand(1);
+	requests.resize(count);
+	for(int i = 0; i < count; i++)
+	{
+		MeshRequest& request = requests[i];
+		request.shape = i % 10 == 0 ? Enum::Shape::Ball : Enum::Shape::Block;
+		Vector3 size((float)(1 + rand() % 8), (float)(1 + rand() % 3), (float)(1 + rand() % 8));
+		if(request.shape == Enum::Shape::Ball)
+			size = Vector3(size.x, size.x, size.x);
+		request.half = size / 2;
+		for(int face = 0; face < 6; face++)
+			request.surfaces[face] = Enum::SurfaceType::Smooth;
+		if(i % 3 == 0)
+			request.surfaces[TOP] = Enum::SurfaceType::Bumps;
+		if(i % 12 == 0)
+			request.surfaces[BOTTOM] = Enum::SurfaceType::Bumps;
+	}
+}
+
+// Builds the same meshes on one thread and then across the pool
+static void runMeshes(int count, int threads)
+{
+	if(threads <= 0)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		threads = info.dwNumberOfProcessors;
+	}
+	std::vector<MeshRequest> requests;
+	fillMeshRequests(requests, count);
+	std::vector<BrickMesh> meshes;
+
+	printf("%-10s %8s %8s %12s %12s %10s %8s\n", "builder", "threads", "meshes", "ms", "meshes/s", "vertices", "speedup");
+	double baseline = 0;
+	for(int t = 1; t <= threads; t = t < threads && t * 2 > threads ? threads : t * 2)
+	{
+		WorkerPool* pool = t > 1 ? new WorkerPool(t - 1) : NULL;
+		RealTime start = System::time();
+		BrickMeshBuilder::buildParts(pool, requests, meshes);
+		double ms = (System::time() - start) * 1000.0;
+		delete pool;
+		if(t == 1)
+			baseline = ms;
+		size_t vertices = 0;
+		for(size_t i = 0; i < meshes.size(); i++)
+			vertices += meshes[i].vertices.size();
+		printf("%-10s %8d %8d %12.1f %12.0f %10u %8.2f\n", t > 1 ? "parallel" : "serial", t, count, ms, count / (ms / 1000.0),
+			(unsigned int)vertices, baseline / ms);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double simSeconds = 10;
+	int threads = 0;
+	bool scaling = false;
+	bool compare = false;
+	bool weld = false;
+	bool boxes = false;
+	bool meshes = false;
+	std::string only;
+	std::string broadphaseName = "hash";
+	std::string replay;
+	std::string csv;
+	for(int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if(arg == "-seconds" && i + 1 < argc)
+			simSeconds = atof(argv[++i]);
+		else if(arg == "-threads" && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if(arg == "-broadphase" && i + 1 < argc)
+			broadphaseName = argv[++i];
+		else if(arg == "-compare")
+			compare = true;
+		else if(arg == "-scaling")
+			scaling = true;
+		else if(arg == "-weld")
+			weld = true;
+		else if(arg == "-boxes")
+			boxes = true;
+		else if(arg == "-meshes")
+			meshes = true;
+		else if(arg == "-replay" && i + 1 < argc)
+			replay = argv[++i];
+		else if(arg == "-csv" && i + 1 < argc)
+			csv = argv[++i];
+		else if(arg == "-scene" && i + 1 < argc)
+			only = argv[++i];
+		else
+		{
+			printf("usage: Benchmark [-seconds n] [-threads n] [-scene name] [-broadphase name | -compare] [-scaling | -boxes] [-weld] [-csv out]\n");
+			printf("       Benchmark -replay log [-threads n] [-csv out]\n");
+			printf("       Benchmark -meshes [-threads n]\n");
+			return 1;
+		}
+	}
+
+	if(meshes)
+	{
+		runMeshes(100000, threads);
+		return 0;
+	}
+
+	FILE* out = NULL;
+	if(!csv.empty())
+	{
+		out = fopen(csv.c_str(), "w");
+		if(out == NULL)
+		{
+			printf("can't write %s\n", csv.c_str());
+			return 1;
+		}
+	}
+
+	if(!replay.empty())
+	{
+		// A session recorded with the client's -record, one row per frame
+		bool ok = replayPhysics(replay, out != NULL ? out : stdout, threads);
+		if(out != NULL)
+			fclose(out);
+		if(!ok)
+		{
+			printf("can't read %s\n", replay.c_str());
+			return 1;
+		}
+		return 0;
+	}
+
+	const size_t sceneCount = sizeof(scenes) / sizeof(scenes[0]);
+	const size_t broadphaseCount = sizeof(broadphases) / sizeof(broadphases[0]);
+	size_t broadphase = broadphaseCount;
+	for(size_t b = 0; b < broadphaseCount; b++)
+	{
+		if(broadphaseName == broadphases[b].name)
+			broadphase = b;
+	}
+	if(broadphase == broadphaseCount)
+	{
+		printf("unknown broadphase %s\n", broadphaseName.c_str());
+		return 1;
+	}
+
+	if(scaling)
+	{
+		// Same scene on 1, 2, 4 ... threads
+		if(only.empty())
+			only = "pile-10k";
+		int maxThreads = threads;
+		if(maxThreads <= 0)
+		{
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			maxThreads = info.dwNumberOfProcessors;
+		}
+		printf("%-16s %8s %8s %12s %8s\n", "scene", "threads", "parts", "ms/step", "speedup");
+		for(size_t s = 0; s < sceneCount; s++)
+		{
+			if(only != scenes[s].name)
+				continue;
+			double baseline = 0;
+			for(int t = 1; t <= maxThreads; t *= 2)
+			{
+				SceneResult result = runScene(scenes[s], broadphases[broadphase], t, simSeconds, weld, true);
+				double ms = result.seconds * 1000.0 / result.steps;
+				if(t == 1)
+					baseline = ms;
+				printf("%-16s %8d %8u %12.3f %8.2f\n", scenes[s].name, t, (unsigned int)result.partCount, ms, baseline / ms);
+			}
+		}
+		if(out != NULL)
+			fclose(out);
+		return 0;
+	}
+
+	if(boxes)
+	{
+		// Aligned box contacts against dBoxBox for every pair, on the brick
+		// scenes that are nearly all aligned box pairs
+		printf("%-16s %-10s %8s %12s %9s %9s %8s\n", "scene", "boxes", "parts", "ms/step", "p50 ms", "p99 ms", "speedup");
+		for(size_t s = 0; s < sceneCount; s++)
+		{
+			std::string name = scenes[s].name;
+			if(only.empty() ? name != "tower" && name != "wall" : only != name)
+				continue;
+			double baseline = 0;
+			for(int aligned = 0; aligned < 2; aligned++)
+			{
+				SceneResult result = runScene(scenes[s], broadphases[broadphase], threads, simSeconds, weld, aligned != 0);
+				double ms = result.seconds * 1000.0 / result.steps;
+				if(!aligned)
+					baseline = ms;
+				printf("%-16s %-10s %8u %12.3f %9.3f %9.3f %8.2f\n", scenes[s].name, aligned ? "aligned" : "dBoxBox",
+					(unsigned int)result.partCount, ms, result.p50, result.p99, baseline / ms);
+			}
+		}
+		if(out != NULL)
+			fclose(out);
+		return 0;
+	}
+
+	printf("%-16s %-10s %8s %8s %10s %9s %9s %9s\n", "scene", "broadphase", "parts", "steps", "steps/s", "p50 ms", "p99 ms", "peak MB");
+	if(out != NULL)
+		fprintf(out, "scene,broadphase,threads,parts,steps,steps_per_s,p50_ms,p99_ms,peak_mb\n");
+	for(size_t s = 0; s < sceneCount; s++)
+	{
+		bool inSuite = compare ? scenes[s].compared : scenes[s].standard;
+		if(only.empty() ? !inSuite : only != scenes[s].name)
+			continue;
+		for(size_t b = 0; b < broadphaseCount; b++)
+		{
+			if(!compare && b != broadphase)
+				continue;
+			SceneResult result = runScene(scenes[s], broadphases[b], threads, simSeconds, weld, true);
+			double rate = result.steps / result.seconds;
+			printf("%-16s %-10s %8u %8d %10.1f %9.3f %9.3f %9.1f\n", scenes[s].name, broadphases[b].name, (unsigned int)result.partCount,
+				result.steps, rate, result.p50, result.p99, result.peakMemory);
+			if(out != NULL)
+			{
+				fprintf(out, "%s,%s,%d,%u,%d,%.2f,%.4f,%.4f,%.2f\n", scenes[s].name, broadphases[b].name, threads, (unsigned int)result.partCount,
+					result.steps, rate, result.p50, result.p99, result.peakMemory);
+			}
+		}
+	}
+	if(out != NULL)
+		fclose(out);
+	return 0;
+}
@@ -9,6 +9,7 @@
 #include "V2DataModel/DataModel.h"
 #include "V2DataModel/GuiRootInstance.h"
 #include "Util/XplicitNgine.h"
+#include "BrickRenderer.h"
 #include "CameraController.h"
 #include "Util/AudioPlayer.h"
 #include "Globals.h"
@@ -174,6 +175,7 @@ void Application::deleteInstance()
 		if(toDelete.size() > 0)
 		{
 			AudioPlayer::playSound(GetFileInPath("/content/sounds/pageturn.wav"));
+			_dataModel->getEngine()->beginMutations();
 			for(size_t i = 0; i < toDelete.size(); i++) {
 				Instance* selectedInstance = toDelete[i];
 				_dataModel->getSelectionService()->removeSelected(selectedInstance);
@@ -181,6 +183,7 @@ void Application::deleteInstance()
 				delete selectedInstance;
 				selectedInstance = NULL;
 			}
+			_dataModel->getEngine()->commitMutations();
 		}
 	}
 	if(_dataModel->getSelectionService()->getSelection().size() == 0)
@@ -197,6 +200,9 @@ void Application::onInit()  {
 	_dataModel->setName("undefined");
 	_dataModel->font = g_fntdominant;
 	g_dataModel = _dataModel;
+	// Hold the editor to its frame rate with cheaper solving, but leave
+	// governSteps off so the simulation never runs slower than real time
+	_dataModel->setPhysicsBudget(20);
 
 #ifdef LEGACY_LOAD_G3DFUN_LEVEL
 	// Anchored this baseplate for XplicitNgine tests
@@ -313,17 +319,20 @@ void Application::onSimulation(RealTime rdt, SimTime sdt, SimTime idt) {
 		Level->Step(sdt);
 
 		// XplicitNgine Start
+		XplicitNgine* engine = _dataModel->getEngine();
+		engine->createQueuedBodies();
+		engine->advance(sdt);
+		engine->interpolate();
+
+		// Only awake parts can have fallen since the last frame
 		std::vector<PartInstance *> toDelete;
-		for(size_t i = 0; i < _dataModel->getWorkspace()->partObjects.size(); i++)
+		const std::vector<PartInstance *>& activeParts = engine->getActiveParts();
+		for(size_t i = 0; i < activeParts.size(); i++)
 		{
-			PartInstance* partInstance = _dataModel->getWorkspace()->partObjects[i];
-			if(partInstance->getPosition().y < -255)
-			{
-				toDelete.push_back(partInstance);
-			}
-			else 
-				_dataModel->getEngine()->createBody(partInstance);
+			if(activeParts[i]->getPosition().y < -255)
+				toDelete.push_back(activeParts[i]);
 		}
+		engine->beginMutations();
 		while(toDelete.size() > 0)
 		{
 			PartInstance * p = toDelete.back();
@@ -333,10 +342,7 @@ void Application::onSimulation(RealTime rdt, SimTime sdt, SimTime idt) {
 			p->setParent(NULL);
 			delete p;
 		}
-		for(int i = 0; i < 4; i++)
-		{
-			_dataModel->getEngine()->step(0.03F);
-		}
+		engine->commitMutations();
 		onLogic();
 		
 	}
@@ -459,6 +465,39 @@ void Application::onKeyPressed(int key)
 	{
 			_dataModel->getOpen();
 	}
+	// Physics profiling: F3 toggles the overlay, F4 dumps the last minute of frames
+	if(key==VK_F3)
+	{
+		GuiRootInstance* guiRoot = _dataModel->getGuiRoot();
+		guiRoot->showPhysicsStats(!guiRoot->isShowingPhysicsStats());
+	}
+	if(key==VK_F4)
+	{
+		XplicitNgine* engine = _dataModel->getEngine();
+		if(engine->dumpStats("physics-stats.csv", false) && engine->dumpStats("physics-stats.json", true))
+			_dataModel->getGuiRoot()->setDebugMessage("Physics stats saved", System::time());
+	}
+	// F5 switches between batched and per-part rendering, to compare draw calls
+	if(key==VK_F5)
+	{
+		BrickRenderer* brickRenderer = _dataModel->getWorkspace()->getBrickRenderer();
+		brickRenderer->setBatching(!brickRenderer->isBatching());
+		_dataModel->getGuiRoot()->setDebugMessage(brickRenderer->isBatching() ? "Batched rendering on" : "Batched rendering off", System::time());
+	}
+	// F6 switches frustum culling, to compare how many parts reach the renderer
+	if(key==VK_F6)
+	{
+		WorkspaceInstance* workspace = _dataModel->getWorkspace();
+		workspace->setCulling(!workspace->isCulling());
+		_dataModel->getGuiRoot()->setDebugMessage(workspace->isCulling() ? "Culling on" : "Culling off", System::time());
+	}
+	// F7 switches level of detail, to compare against full detail everywhere
+	if(key==VK_F7)
+	{
+		BrickRenderer* brickRenderer = _dataModel->getWorkspace()->getBrickRenderer();
+		brickRenderer->setLod(!brickRenderer->isLod());
+		_dataModel->getGuiRoot()->setDebugMessage(brickRenderer->isLod() ? "Level of detail on" : "Level of detail off", System::time());
+	}
 	tool->onKeyDown(key);
 }
 void Application::onKeyUp(int key)
@@ -10,6 +10,7 @@
 #include "ax.h"
 #include <commctrl.h>
 #include "Util/ErrorFunctions.h"
+#include "Util/PhysicsRecorder.h"
 
 #if G3D_VER < 61000
 	#error Requires G3D 6.10
@@ -145,6 +146,14 @@ int main(int argc, char** argv) {
 #ifndef _DEBUG
 	try{
 #endif
+		// -record <file> logs the physics session for the benchmark's -replay
+		static PhysicsRecorder recorder;
+		for(int i = 1; i + 1 < argc; i++)
+		{
+			if(strcmp(argv[i], "-record") == 0 && recorder.open(argv[i + 1]))
+				g_physicsRecorder = &recorder;
+		}
+
 		hresult = OleInitialize(NULL);
 		if (!AXRegister())
 			return 0;
@@ -0,0 +1,57 @@
+#ifndef BRICKMESHBUILDER
+#define BRICKMESHBUILDER
+#include "Enum.h"
+#include <G3DAll.h>
+#include <vector>
+
+class WorkerPool;
+
+// Triangle list in part space. Indices count up from 0 over the vertices.
+struct BrickMesh
+{
+	std::vector<Vector3> vertices;
+	std::vector<Vector3> normals;
+	std::vector<int> indices;
+	void clear();
+};
+
+// What a part's mesh is built from. Hinges and motors aren't meshed, they
+// stay quadrics in the legacy display lists.
+struct MeshRequest
+{
+	Enum::Shape::Value shape;
+	Vector3 half;
+	Enum::SurfaceType::Value surfaces[6];
+};
+
+// Builds brick geometry on the CPU. Nothing here touches GL or any shared
+// state, so meshes can be built on any thread, as many at once as wanted.
+class BrickMeshBuilder
+{
+public:
+	// A block vertex is sign * half size + offset, which keeps the bevels
+	// the same width at every size
+	struct TemplateVertex
+	{
+		Vector3 sign;
+		Vector3 offset;
+		Vector3 normal;
+	};
+	// Worked out once, before main
+	static const std::vector<TemplateVertex>& getBlockTemplate();
+
+	// Each of these appends to out
+	static void buildBlock(const Vector3& half, BrickMesh& out);
+	static void buildBall(const Vector3& half, int slices, int stacks, BrickMesh& out);
+	static void buildCylinder(const Vector3& half, int slices, BrickMesh& out);
+	// columns x rows studs, one per unit of the frame's XZ plane from its origin
+	static void buildStuds(int columns, int rows, const CoordinateFrame& frame, BrickMesh& out);
+	static void buildPart(const MeshRequest& request, BrickMesh& out);
+	// One mesh per request. Spread over pool's threads when given one.
+	static void buildParts(WorkerPool* pool, const std::vector<MeshRequest>& requests, std::vector<BrickMesh>& meshes);
+};
+
+// Where a face's studs sit: the face's frame in part space, with rows running
+// along Z and columns along X
+CoordinateFrame studFrame(int face, const Vector3& half, int& columns, int& rows);
+#endif
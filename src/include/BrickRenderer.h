@@ -0,0 +1,189 @@
+#ifndef BRICKRENDERER
+#define BRICKRENDERER
+#include <G3DAll.h>
+#include <vector>
+#include <map>
+#include "V2DataModel/Part.h"
+#include "BrickMeshBuilder.h"
+#include "RenderQueue.h"
+
+// Counts from the last frame drawn
+struct RenderStats
+{
+	RenderStats();
+	int drawCalls;
+	int batchedParts;
+	// Parts that drew themselves through their own display list
+	int legacyParts;
+	int vertices;
+	// Studs drawn as geometry, the rest are texture
+	int studs;
+	// Batched parts at each level of detail, full first
+	int lodParts[3];
+	// Static chunks drawn and the anchored parts baked into them
+	int chunks;
+	int bakedParts;
+	StateChanges stateChanges;
+};
+
+// Draws the workspace's parts a kind at a time. Each kind (block, ball, stud,
+// studded face) has one unit mesh. Every frame the parts of a kind are packed
+// as transform, size and color, expanded into one vertex buffer and sent in a
+// single draw. Cylinders and parts with hinges or motors still draw themselves.
+//
+// A Bumps face is one quad tiled with a stud texture. Only the studs within
+// studDistance of the camera are real geometry, so a baseplate costs about
+// the same at any size.
+//
+// Parts small on screen drop to cheaper tiers: the middle tier loses bevels
+// and stud geometry and draws coarser balls, the lowest also loses the stud
+// texture. A part has to grow a little past a threshold to climb back.
+//
+// Anchored parts are baked into static chunks, one per chunkSize square of
+// the XZ plane, each a pre-transformed vertex buffer drawn in two calls.
+// Editing a part only dirties its chunk, which is rebuilt on a background
+// thread; until then its parts are drawn with everything else.
+//
+// Nothing is drawn as it's found. Every draw goes into a render queue that is
+// sorted and sent once the frame's parts have all been gathered.
+class BrickRenderer
+{
+public:
+	BrickRenderer();
+	~BrickRenderer();
+	// Chunks culled by clipPlanes, when given, are skipped
+	void render(RenderDevice* rd, const std::vector<PartInstance*>& parts, const Array<Plane>* clipPlanes = NULL);
+	// Off draws every part the old way, in tree order, for comparison
+	void setBatching(bool batching);
+	bool isBatching();
+	void setStudDistance(float distance);
+	float getStudDistance();
+	static const int lodTiers = 3;
+	// Off draws every part at full detail
+	void setLod(bool lod);
+	bool isLod();
+	// Screen sizes, in pixels across, below which parts drop to the middle
+	// and lowest tiers
+	void setLodPixels(float medium, float low);
+	// How far past a threshold, as a fraction of it, a part must grow to
+	// climb a tier
+	void setLodHysteresis(float hysteresis);
+
+	static const int chunkSize = 64;
+	// Call when a part is added or edited: files it under the chunk for its
+	// position if it's anchored, and dirties the chunks it leaves and joins
+	void updateStatic(PartInstance* part);
+	void removeStatic(PartInstance* part);
+	void clearStatic();
+	const RenderStats& getStats();
+private:
+	enum Kind
+	{
+		BLOCK,
+		BLOCK_FLAT,
+		BALL,
+		BALL_MEDIUM,
+		BALL_LOW,
+		STUD,
+		STUD_FACE,
+		KIND_COUNT
+	};
+	// Unit mesh vertex. Blocks place it at sign * half size + offset so the
+	// bevels keep their width at any size, the other kinds only use offset.
+	struct MeshVertex
+	{
+		Vector3 sign;
+		Vector3 offset;
+		Vector3 normal;
+	};
+	struct BrickInstance
+	{
+		CoordinateFrame cFrame;
+		Vector3 size;
+		Color3 color;
+	};
+
+	// Anchored parts in one cell, and the vertex buffers baked from them
+	struct StaticChunk
+	{
+		StaticChunk();
+		std::vector<PartInstance*> parts;
+		// Edited since the last snapshot
+		bool dirty;
+		bool building;
+		// The buffers match parts
+		bool ready;
+		AABox bounds;
+		// Snapshot taken for the builder, and what it expands it into
+		Array<BrickInstance> instances[KIND_COUNT];
+		Array<Vector3> solidPositions;
+		Array<Vector3> solidNormals;
+		Array<Color3> solidColors;
+		Array<Vector3> facePositions;
+		Array<Vector3> faceNormals;
+		Array<Color3> faceColors;
+		Array<Vector2> faceTexCoords;
+		// Blocks and balls in one draw, the textured stud faces in another
+		VARAreaRef varArea;
+		int solidVertices;
+		int faceVertices;
+		VAR solidVertexArray;
+		VAR solidNormalArray;
+		VAR solidColorArray;
+		VAR faceVertexArray;
+		VAR faceNormalArray;
+		VAR faceColorArray;
+		VAR faceTexCoordArray;
+	};
+	class ChunkBuilder;
+	friend class ChunkBuilder;
+
+	void buildMeshes();
+	// Copies a builder mesh into a kind that only uses the offset
+	static void addUnitMesh(const BrickMesh& mesh, std::vector<MeshVertex>& kind);
+	bool canBatch(PartInstance* part);
+	int pickTier(PartInstance* part, const Vector3& camera);
+	void addPart(PartInstance* part, const Vector3& camera);
+	// The part's body and studded faces at a tier, appended to kinds
+	void addBody(PartInstance* part, int tier, Array<BrickInstance>* kinds);
+	void addStudGeometry(PartInstance* part, const Vector3& camera);
+	void buildStudTexture();
+	// Expands a kind's instances into the arrays from index start on. Only
+	// reads the meshes, so the chunk builder can call it.
+	void expand(int kind, const Array<BrickInstance>& kindInstances, int start, Array<Vector3>& positions, Array<Vector3>& normals, Array<Color3>& colors, Array<Vector2>* texCoords) const;
+	void buildChunk(StaticChunk& chunk) const;
+	void startChunkBuilds();
+	void uploadChunk(StaticChunk& chunk);
+	bool isBaked(PartInstance* part);
+	void queueChunks(const Vector3& camera, const Array<Plane>* clipPlanes);
+	int legacyDrawCalls(PartInstance* part);
+	void queueLegacy(PartInstance* part);
+
+	bool batching;
+	bool meshesBuilt;
+	float studDistance;
+	TextureRef studTexture;
+	bool lod;
+	float lodPixels[lodTiers - 1];
+	float lodHysteresis;
+	// Pixels per unit of size at unit distance, for this frame's camera
+	float projectionScale;
+	std::vector<StaticChunk*> chunks;
+	std::map<std::pair<int, int>, int> chunkCells;
+	// Running builds, NULL when none are
+	ChunkBuilder* chunkBuilder;
+	std::vector<MeshVertex> meshes[KIND_COUNT];
+	Array<BrickInstance> instances[KIND_COUNT];
+	std::vector<PartInstance*> legacyParts;
+	// Scratch for the kind being expanded
+	Array<Vector3> positions;
+	Array<Vector3> normals;
+	Array<Color3> colors;
+	Array<Vector2> texCoords;
+	VARAreaRef varArea;
+	RenderQueue queue;
+	RenderStats stats;
+};
+
+Enum::SurfaceType::Value partSurface(PartInstance* part, int face);
+#endif
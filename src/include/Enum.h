@@ -40,4 +40,10 @@ namespace Enum
 			Snap = 8, Page = 9
 		};
 	}
-}
\ No newline at end of file
+	namespace Broadphase
+	{
+		enum Value {
+			Hash = 0, QuadTree = 1, Simple = 2, SweepAndPrune = 3
+		};
+	}
+}
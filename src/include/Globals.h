@@ -3,6 +3,7 @@
 #include "Util/XplicitNgine.h"
 
 class Application;
+class PhysicsRecorder;
 
 class Globals
 {
@@ -26,6 +27,8 @@ extern std::vector<Instance*> postRenderStack;
 extern bool running;
 extern DataModelManager* g_dataModel;
 extern XplicitNgine* g_xplicitNgine;
+// Set while a session is being recorded with -record
+extern PhysicsRecorder* g_physicsRecorder;
 extern Application* g_usableApp;
 extern SkyRef g_sky;
 extern RenderDevice g_renderDevice;
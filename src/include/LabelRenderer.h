@@ -0,0 +1,54 @@
+#ifndef LABELRENDERER
+#define LABELRENDERER
+#include <G3DAll.h>
+#include <vector>
+#include "V2DataModel/Part.h"
+
+// Draws the names of parts with nameShown, all in one pass. Labels past
+// maxDistance or outside the view are dropped. The rest are laid out back to
+// front into one glyph buffer and sent in a single draw, each label the same
+// yellow on a black border GFont::draw3D gave it.
+//
+// GFont keeps its glyph layout and texture to itself, so the pass reads the
+// same .fnt file into a glyph table and texture of its own.
+class LabelRenderer
+{
+public:
+	LabelRenderer(const std::string& fontFile);
+	void render(RenderDevice* rd, const std::vector<PartInstance*>& parts, const Array<Plane>& clipPlanes);
+	void setMaxDistance(float distance);
+	float getMaxDistance();
+	// Labels and glyph quads drawn last frame
+	int getLabelCount();
+	int getGlyphCount();
+private:
+	struct Label
+	{
+		PartInstance* part;
+		Vector3 position;
+		float distance;
+	};
+	static bool fartherFirst(const Label& a, const Label& b);
+	bool loadFont();
+	// Width of s with glyphs w wide, proportionally spaced
+	float stringWidth(const std::string& s, float w) const;
+	// Appends a quad per glyph of s, from (x, y) in label space where y runs
+	// down, to the glyph arrays
+	void addString(const std::string& s, const Vector3& origin, const Vector3& right, const Vector3& up, float x, float y, float w, float h, const Color4& color);
+
+	std::string fontFile;
+	bool fontLoaded;
+	TextureRef fontTexture;
+	int charWidth;
+	int charHeight;
+	int glyphWidths[128];
+	float maxDistance;
+	std::vector<Label> labels;
+	Array<Vector3> positions;
+	Array<Vector2> texCoords;
+	Array<Color4> colors;
+	VARAreaRef varArea;
+	int labelCount;
+	int glyphCount;
+};
+#endif
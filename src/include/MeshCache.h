@@ -0,0 +1,41 @@
+#ifndef MESHCACHE
+#define MESHCACHE
+#include "Enum.h"
+#include <G3DAll.h>
+#include <map>
+
+// What a part's display list depends on. Size is kept to a hundredth of a
+// stud and the controller only counts when a face has a motor to colour.
+struct MeshKey
+{
+	MeshKey();
+	MeshKey(Enum::Shape::Value shape, const Vector3& size, const Enum::SurfaceType::Value surfaces[6], Enum::Controller::Value controller);
+	bool operator<(const MeshKey& other) const;
+	bool operator==(const MeshKey& other) const;
+	int shape;
+	int size[3];
+	int surfaces[6];
+	int controller;
+};
+
+// Display lists shared by every part with the same key. Lists leave the
+// part's colour and material out, whoever calls them sets those first.
+class MeshCache
+{
+public:
+	// Takes a reference on key's list, compiling it on first use
+	static GLuint acquire(const MeshKey& key);
+	// Drops a reference, deleting the list with the last one
+	static void release(const MeshKey& key);
+	static int getMeshCount();
+	static int getReferenceCount();
+private:
+	struct Entry
+	{
+		GLuint list;
+		int references;
+	};
+	static std::map<MeshKey, Entry> entries;
+	static int references;
+};
+#endif
@@ -0,0 +1,80 @@
+#ifndef RENDERQUEUE
+#define RENDERQUEUE
+#include <G3DAll.h>
+#include <vector>
+
+// GL state the queue changed during its last submit
+struct StateChanges
+{
+	StateChanges();
+	int total() const;
+	int materials;
+	int textures;
+	// Vertex buffers switched, each one closes and reopens G3D's indexed
+	// primitive block
+	int buffers;
+	int transforms;
+	int colors;
+};
+
+// Vertex buffers for one arrays draw, all allocated from area
+struct DrawArrays
+{
+	DrawArrays();
+	VARAreaRef area;
+	VAR vertices;
+	VAR normals;
+	VAR colors;
+	// Left invalid for untextured draws
+	VAR texCoords;
+	// Triangles are sent as sequential indices
+	int count;
+};
+
+// A frame's draws. They're added in whatever order the scene hands them over,
+// sorted so that draws sharing state sit together, then submitted changing
+// only the state that differs from the draw before. Arrays draws are already
+// in world space, list draws call a display list at a transform and colour.
+//
+// Sorting goes material, texture, buffer, shape: the costlier the change, the
+// fewer times it happens.
+class RenderQueue
+{
+public:
+	enum Material
+	{
+		// The specular plastic every brick is made of
+		PLASTIC,
+		// Plastic pulled towards the camera so it draws over the face under it
+		PLASTIC_DECAL,
+		MATERIAL_COUNT
+	};
+	RenderQueue();
+	void clear();
+	void addArrays(int shape, Material material, const TextureRef& texture, const DrawArrays& arrays);
+	void addList(int shape, Material material, GLuint list, const CoordinateFrame& cFrame, const Color3& color);
+	// Unsorted sends the draws in the order they were added, for comparison
+	void submit(RenderDevice* rd, bool sort = true);
+	int size() const;
+	const StateChanges& getStateChanges() const;
+private:
+	struct DrawItem
+	{
+		int shape;
+		Material material;
+		TextureRef texture;
+		DrawArrays arrays;
+		// 0 for arrays draws
+		GLuint list;
+		CoordinateFrame cFrame;
+		Color3 color;
+	};
+	static bool drawsBefore(const DrawItem* a, const DrawItem* b);
+	void setMaterial(RenderDevice* rd, Material material);
+
+	std::vector<DrawItem> items;
+	// Kept between frames so sorting doesn't reallocate
+	std::vector<const DrawItem*> order;
+	StateChanges stateChanges;
+};
+#endif
@@ -2,6 +2,8 @@
 #define RENDERUTIL
 #include "Enum.h"
 #include "V2DataModel/Instance.h"
-void renderShape(const Enum::Shape::Value& shape, const Vector3& size, const Color3& ncolor);
-void renderSurface(const char face, const Enum::SurfaceType::Value& surface, const Vector3& size, const Enum::Controller::Value& controller, const Color3& color);
+// Draw in the current colour, the part's. Motors, hinges and cylinder marks
+// set their own and put it back.
+void renderShape(const Enum::Shape::Value& shape, const Vector3& size);
+void renderSurface(const char face, const Enum::SurfaceType::Value& surface, const Vector3& size, const Enum::Controller::Value& controller);
 #endif
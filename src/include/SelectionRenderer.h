@@ -0,0 +1,67 @@
+#ifndef SELECTIONRENDERER
+#define SELECTIONRENDERER
+#include <G3DAll.h>
+#include <vector>
+#include "V2DataModel/Part.h"
+
+// Draws the selection's outlines and handles. They're generated into one
+// triangle buffer that is kept until the selection, a selected part's
+// transform or the kind of handles changes, and drawn every frame in a single
+// call. Resize handles keep their size on screen, so while they show the
+// buffer is also rebuilt when the camera moves.
+//
+// Markers are translucent spheres a tool gathers for one frame, all sent in
+// one draw.
+class SelectionRenderer
+{
+public:
+	enum Handles
+	{
+		NO_HANDLES,
+		ARROW_HANDLES,
+		RESIZE_HANDLES
+	};
+	SelectionRenderer();
+	// version has to change whenever the selection does
+	void render(RenderDevice* rd, const std::vector<Instance*>& selection, int version, Handles handles);
+	void renderMarkers(RenderDevice* rd, const Array<Sphere>& markers, const Color4& color);
+	// Times the buffer has been generated, and the vertices in it
+	int getBuildCount();
+	int getVertexCount();
+private:
+	// What the buffer was generated from
+	struct Snapshot
+	{
+		PartInstance* part;
+		CoordinateFrame cFrame;
+		Vector3 size;
+	};
+	bool isStale(int version, Handles handles, const Vector3& camera);
+	void build(const std::vector<Instance*>& selection, const Vector3& camera);
+	void addBox(const CoordinateFrame& cFrame, const Vector3& corner0, const Vector3& corner1, const Color3& color);
+	void addOutline(const CoordinateFrame& cFrame, const Vector3& half);
+	void addArrow(const Vector3& start, const Vector3& direction, const Color3& color);
+	void addSphere(const Vector3& center, float radius, const Color3& color);
+	void buildUnitSphere();
+	void addTriangle(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& normalA, const Vector3& normalB, const Vector3& normalC, const Color3& color);
+
+	std::vector<Snapshot> snapshots;
+	int builtVersion;
+	Handles builtHandles;
+	Vector3 builtCamera;
+	int buildCount;
+	// Unit sphere as a plain triangle list, its normals are its positions
+	Array<Vector3> unitSphere;
+	Array<Vector3> positions;
+	Array<Vector3> normals;
+	Array<Color3> colors;
+	VARAreaRef varArea;
+	VAR vertexArray;
+	VAR normalArray;
+	VAR colorArray;
+	int vertexCount;
+	Array<Vector3> markerPositions;
+	Array<Vector3> markerNormals;
+	VARAreaRef markerArea;
+};
+#endif
@@ -0,0 +1,487 @@
+#include "BrickMeshBuilder.h"
+#include "Faces.h"
+#include "util/WorkerPool.h"
+
+static const float bevelSize = 0.05F;
+
+static const int BMP_FACES = 5*2;
+static const float bumpTriangles[] = {
+	//Top
+    -0.3F, 0.1F, -0.3F,
+	-0.3F, 0.1F, 0.3F,
+	0.3F, 0.1F, -0.3F,
+
+	0.3F, 0.1F, -0.3F,
+	-0.3F, 0.1F, 0.3F,
+	0.3F, 0.1F, 0.3F,
+
+
+	//Front
+	-0.3F, 0.1F, 0.3F,
+	-0.3F, -0.1F, 0.3F,
+	0.3F, 0.1F, 0.3F,
+	
+	0.3F, 0.1F, 0.3F,
+	-0.3F, -0.1F, 0.3F,
+	0.3F, -0.1F, 0.3F,
+
+
+	//Back
+	-0.3F, -0.1F, -0.3F,
+	-0.3F, 0.1F, -0.3F,
+	0.3F, -0.1F, -0.3F,
+	
+	0.3F, -0.1F, -0.3F,
+	-0.3F, 0.1F, -0.3F,
+	0.3F, 0.1F, -0.3F,
+
+
+	//Right
+	0.3F, -0.1F, -0.3F,
+	0.3F, 0.1F, -0.3F,
+	0.3F, -0.1F, 0.3F,
+	
+	0.3F, -0.1F, 0.3F,
+	0.3F, 0.1F, -0.3F,
+	0.3F, 0.1F, 0.3F,
+
+
+	//Left
+	-0.3F, 0.1F, -0.3F,
+	-0.3F, -0.1F, -0.3F,
+	-0.3F, 0.1F, 0.3F,
+	
+	-0.3F, 0.1F, 0.3F,
+	-0.3F, -0.1F, -0.3F,
+	-0.3F, -0.1F, 0.3F,
+};
+
+static const float bumpTriangleNormals[] = {
+	0.000000F, 1.000000F, 0.000000F,
+	0.000000F, 1.000000F, 0.000000F,
+	0.000000F, 1.000000F, 0.000000F,
+	0.000000F, 1.000000F, -0.000000F,
+	-0.000000F, 1.000000F, 0.000000F,
+	0.000000F, 1.000000F, 0.000000F,
+	-0.000000F, 0.000000F, 1.000000F,
+	0.000000F, 0.000000F, 1.000000F,
+	0.000000F, 0.000000F, 1.000000F,
+	0.000000F, 0.000000F, 1.000000F,
+	0.000000F, 0.000000F, 1.000000F,
+	0.000000F, -0.000000F, 1.000000F,
+	0.000000F, 0.000000F, -1.000000F,
+	0.000000F, 0.000000F, -1.000000F,
+	0.000000F, 0.000000F, -1.000000F,
+	0.000000F, 0.000000F, -1.000000F,
+	0.000000F, 0.000000F, -1.000000F,
+	-0.000000F, -0.000000F, -1.000000F,
+	1.000000F, 0.000000F, 0.000000F,
+	1.000000F, 0.000000F, 0.000000F,
+	1.000000F, 0.000000F, 0.000000F,
+	1.000000F, -0.000000F, 0.000000F,
+	1.000000F, 0.000000F, -0.000000F,
+	1.000000F, 0.000000F, 0.000000F,
+	-1.000000F, 0.000000F, 0.000000F,
+	-1.000000F, 0.000000F, 0.000000F,
+	-1.000000F, 0.000000F, -0.000000F,
+	-1.000000F, -0.000000F, 0.000000F,
+	-1.000000F, 0.000000F, 0.000000F,
+	-1.000000F, 0.000000F, 0.000000F,
+};
+
+void BrickMesh::clear()
+{
+	vertices.clear();
+	normals.clear();
+	indices.clear();
+}
+
+// Loose triangles for one block while it's being put together
+struct BlockSoup
+{
+	std::vector<Vector3> vertices;
+	std::vector<Vector3> normals;
+	void addTriangle(const Vector3& v1, const Vector3& v2, const Vector3& v3)
+	{
+		vertices.push_back(v1);
+		vertices.push_back(v2);
+		vertices.push_back(v3);
+		normals.push_back(cross(v2-v1,v3-v1).direction());
+		normals.push_back(cross(v3-v2,v1-v2).direction());
+		normals.push_back(cross(v1-v3,v2-v3).direction());
+	}
+	// Takes offsets into the old interleaved position and colour array,
+	// six floats a vertex, so the bevel table reads as it always has
+	void makeFace(int vertex1, int vertex2, int vertex3)
+	{
+		addTriangle(vertices[vertex1 / 6], vertices[vertex2 / 6], vertices[vertex3 / 6]);
+	}
+};
+
+static void buildBlockSoup(const Vector3& half, BlockSoup& soup)
+{
+	soup.addTriangle(Vector3(half.x-bevelSize,half.y-bevelSize,half.z),
+					Vector3(-half.x+bevelSize,-half.y+bevelSize,half.z),
+					Vector3(half.x-bevelSize,-half.y+bevelSize,half.z)
+					);
+
+				soup.addTriangle(Vector3(-half.x+bevelSize,half.y-bevelSize,half.z),
+					Vector3(-half.x+bevelSize,-half.y+bevelSize,half.z),
+					Vector3(half.x-bevelSize,half.y-bevelSize,half.z)
+					);
+
+				// Top
+				soup.addTriangle(Vector3(half.x-bevelSize,half.y,half.z-bevelSize),
+					Vector3(half.x-bevelSize,half.y,-half.z+bevelSize),
+					Vector3(-half.x+bevelSize,half.y,half.z-bevelSize)
+					);
+				soup.addTriangle(Vector3(-half.x+bevelSize,half.y,half.z-bevelSize),
+					Vector3(half.x-bevelSize,half.y,-half.z+bevelSize),
+					Vector3(-half.x+bevelSize,half.y,-half.z+bevelSize)
+					);
+
+				// Back
+				soup.addTriangle(Vector3(half.x-bevelSize,half.y-bevelSize,-half.z),
+					Vector3(half.x-bevelSize,-half.y+bevelSize,-half.z),
+					Vector3(-half.x+bevelSize,-half.y+bevelSize,-half.z)
+					);
+				soup.addTriangle(Vector3(half.x-bevelSize,half.y-bevelSize,-half.z),
+					Vector3(-half.x+bevelSize,-half.y+bevelSize,-half.z),
+					Vector3(-half.x+bevelSize,half.y-bevelSize,-half.z)
+					);
+
+				// Bottom
+				soup.addTriangle(Vector3(half.x-bevelSize,-half.y,-half.z+bevelSize),
+					Vector3(half.x-bevelSize,-half.y,half.z-bevelSize),
+					Vector3(-half.x+bevelSize,-half.y,half.z-bevelSize)
+					);
+				soup.addTriangle(Vector3(-half.x+bevelSize,-half.y,half.z-bevelSize),
+					Vector3(-half.x+bevelSize,-half.y,-half.z+bevelSize),
+					Vector3(half.x-bevelSize,-half.y,-half.z+bevelSize)
+					);
+ 				// Left
+				soup.addTriangle(Vector3(-half.x,half.y-bevelSize,-half.z+bevelSize),
+					Vector3(-half.x,-half.y+bevelSize,half.z-bevelSize),
+					Vector3(-half.x,half.y-bevelSize,half.z-bevelSize)
+					);
+				soup.addTriangle(Vector3(-half.x,-half.y+bevelSize,half.z-bevelSize),
+					Vector3(-half.x,half.y-bevelSize,-half.z+bevelSize),
+					Vector3(-half.x,-half.y+bevelSize,-half.z+bevelSize)
+					);
+
+ 				// Right
+				soup.addTriangle(Vector3(half.x,half.y-bevelSize,half.z-bevelSize),
+					Vector3(half.x,-half.y+bevelSize,half.z-bevelSize),
+					Vector3(half.x,half.y-bevelSize,-half.z+bevelSize)
+					);
+				soup.addTriangle(Vector3(half.x,-half.y+bevelSize,-half.z+bevelSize),
+					Vector3(half.x,half.y-bevelSize,-half.z+bevelSize),
+					Vector3(half.x,-half.y+bevelSize,half.z-bevelSize)
+					);
+
+	// Bevels, stitched between the faces above
+
+	// Bevel Top Front
+	soup.makeFace(0,36,48);
+	soup.makeFace(48,18,0);
+	// Bevel Left Front Corner
+	soup.makeFace(18,156,162);
+	soup.makeFace(24,18,162);
+	// Bevel Left Front Top Corner
+	soup.makeFace(48,156,18);
+	// Bevel Left Front Bottom Corner
+	soup.makeFace(120,6,150);
+	// Bevel Left Top
+	soup.makeFace(48,66,156);
+	soup.makeFace(144,156,66);
+	// Bevel Bottom
+	soup.makeFace(6,120,114);
+	soup.makeFace(114,12,6);
+	// Left Bottom
+	soup.makeFace(120,150,174);
+	soup.makeFace(174,132,120);
+	// Right Front Top Corner
+	soup.makeFace(36,0,180);
+	// Right Front Corner
+	soup.makeFace(180,0,12);
+	soup.makeFace(186,180,12);
+	// Right Front Bottom Corner
+	soup.makeFace(186,12,114);
+	// Right Bottom
+	soup.makeFace(186,114,108);
+	soup.makeFace(108,198,186);
+	// Right Top Corner
+	soup.makeFace(180,192,36);
+	soup.makeFace(192,42,36);
+	// Right Back Top Corner
+	soup.makeFace(72,42,192);
+	// Right Back Bottom Corner
+	soup.makeFace(78,198,108);
+	// Right Back Corner
+	soup.makeFace(72,192,198);
+	soup.makeFace(198,78,72);
+	// Back Bottom Corner
+	soup.makeFace(78,108,132);
+	soup.makeFace(132,84,78);
+	// Back Top
+	soup.makeFace(42,72,102);
+	soup.makeFace(102,66,42);
+	// Back Left Top Corner
+	soup.makeFace(144,66,102);
+	// Back Left Corner
+	soup.makeFace(144,102,84);
+	soup.makeFace(84,174,144);
+	// Back Left Bottom Corner
+	soup.makeFace(174,84,132);
+}
+
+// Bevels are a fixed width, so build the block at two sizes and keep how
+// each vertex moves with the size
+static std::vector<BrickMeshBuilder::TemplateVertex> makeBlockTemplate()
+{
+	BlockSoup small;
+	BlockSoup large;
+	Vector3 smallSize(1, 1, 1);
+	Vector3 largeSize(2, 3, 5);
+	buildBlockSoup(smallSize, small);
+	buildBlockSoup(largeSize, large);
+	std::vector<BrickMeshBuilder::TemplateVertex> result;
+	for(size_t i = 0; i < small.vertices.size(); i++)
+	{
+		BrickMeshBuilder::TemplateVertex vertex;
+		for(int axis = 0; axis < 3; axis++)
+		{
+			float sign = (large.vertices[i][axis] - small.vertices[i][axis]) / (largeSize[axis] - smallSize[axis]);
+			vertex.sign[axis] = sign > 0.5F ? 1.0F : (sign < -0.5F ? -1.0F : 0.0F);
+			vertex.offset[axis] = small.vertices[i][axis] - vertex.sign[axis] * smallSize[axis];
+		}
+		vertex.normal = large.normals[i];
+		result.push_back(vertex);
+	}
+	return result;
+}
+
+static const std::vector<BrickMeshBuilder::TemplateVertex> blockTemplate = makeBlockTemplate();
+
+const std::vector<BrickMeshBuilder::TemplateVertex>& BrickMeshBuilder::getBlockTemplate()
+{
+	return blockTemplate;
+}
+
+static void addVertex(const Vector3& vertex, const Vector3& normal, BrickMesh& out)
+{
+	out.indices.push_back((int)out.vertices.size());
+	out.vertices.push_back(vertex);
+	out.normals.push_back(normal);
+}
+
+void BrickMeshBuilder::buildBlock(const Vector3& half, BrickMesh& out)
+{
+	for(size_t i = 0; i < blockTemplate.size(); i++)
+	{
+		const TemplateVertex& vertex = blockTemplate[i];
+		addVertex(vertex.sign * half + vertex.offset, vertex.normal, out);
+	}
+}
+
+void BrickMeshBuilder::buildBall(const Vector3& half, int slices, int stacks, BrickMesh& out)
+{
+	for(int i = 0; i < stacks; i++)
+	{
+		float phi0 = (float)G3D::pi() * i / stacks;
+		float phi1 = (float)G3D::pi() * (i + 1) / stacks;
+		for(int j = 0; j < slices; j++)
+		{
+			float theta0 = (float)G3D::twoPi() * j / slices;
+			float theta1 = (float)G3D::twoPi() * (j + 1) / slices;
+			Vector3 corners[4] = {
+				Vector3(sin(phi0) * cos(theta0), cos(phi0), sin(phi0) * sin(theta0)),
+				Vector3(sin(phi1) * cos(theta0), cos(phi1), sin(phi1) * sin(theta0)),
+				Vector3(sin(phi1) * cos(theta1), cos(phi1), sin(phi1) * sin(theta1)),
+				Vector3(sin(phi0) * cos(theta1), cos(phi0), sin(phi0) * sin(theta1))
+			};
+			const int triangles[2][3] = {{0, 1, 2}, {0, 2, 3}};
+			for(int t = 0; t < 2; t++)
+			{
+				const Vector3& a = corners[triangles[t][0]];
+				const Vector3& b = corners[triangles[t][1]];
+				const Vector3& c = corners[triangles[t][2]];
+				// Skip the slivers at the poles
+				if((b - a).cross(c - a).squaredLength() < 1e-10F)
+					continue;
+				bool outward = (b - a).cross(c - a).dot(a + b + c) > 0;
+				const Vector3* order[3] = {&a, outward ? &b : &c, outward ? &c : &b};
+				for(int k = 0; k < 3; k++)
+					addVertex(*order[k] * half, (*order[k] / half).direction(), out);
+			}
+		}
+	}
+}
+
+void BrickMeshBuilder::buildCylinder(const Vector3& half, int slices, BrickMesh& out)
+{
+	// Along X like the gluCylinder it stands in for, capped at both ends
+	for(int j = 0; j < slices; j++)
+	{
+		float theta0 = (float)G3D::twoPi() * j / slices;
+		float theta1 = (float)G3D::twoPi() * (j + 1) / slices;
+		Vector3 round0(0, cos(theta0), sin(theta0));
+		Vector3 round1(0, cos(theta1), sin(theta1));
+		Vector3 normal0 = (round0 / half).direction();
+		Vector3 normal1 = (round1 / half).direction();
+		Vector3 a = (round0 + Vector3(-1, 0, 0)) * half;
+		Vector3 b = (round1 + Vector3(-1, 0, 0)) * half;
+		Vector3 c = (round1 + Vector3(1, 0, 0)) * half;
+		Vector3 d = (round0 + Vector3(1, 0, 0)) * half;
+		addVertex(a, normal0, out);
+		addVertex(b, normal1, out);
+		addVertex(c, normal1, out);
+		addVertex(a, normal0, out);
+		addVertex(c, normal1, out);
+		addVertex(d, normal0, out);
+		addVertex(Vector3(half.x, 0, 0), Vector3::unitX(), out);
+		addVertex(d, Vector3::unitX(), out);
+		addVertex(c, Vector3::unitX(), out);
+		addVertex(Vector3(-half.x, 0, 0), -Vector3::unitX(), out);
+		addVertex(b, -Vector3::unitX(), out);
+		addVertex(a, -Vector3::unitX(), out);
+	}
+}
+
+void BrickMeshBuilder::buildStuds(int columns, int rows, const CoordinateFrame& frame, BrickMesh& out)
+{
+	for(int i = 0; i < rows; i++)
+	{
+		for(int j = 0; j < columns; j++)
+		{
+			for(int k = 0; k < BMP_FACES * 3; k++)
+			{
+				Vector3 vertex(bumpTriangles[k*3] + j, bumpTriangles[k*3+1], bumpTriangles[k*3+2] + i);
+				Vector3 normal(bumpTriangleNormals[k*3], bumpTriangleNormals[k*3+1], bumpTriangleNormals[k*3+2]);
+				addVertex(frame.pointToWorldSpace(vertex), frame.vectorToWorldSpace(normal), out);
+			}
+		}
+	}
+}
+
+void BrickMeshBuilder::buildPart(const MeshRequest& request, BrickMesh& out)
+{
+	switch(request.shape)
+	{
+	case Enum::Shape::Block:
+		buildBlock(request.half, out);
+		break;
+	case Enum::Shape::Ball:
+		buildBall(request.half, 20, 20, out);
+		break;
+	default:
+		buildCylinder(request.half, 12, out);
+		break;
+	}
+	for(int face = 0; face < 6; face++)
+	{
+		if(request.surfaces[face] != Enum::SurfaceType::Bumps)
+			continue;
+		int columns;
+		int rows;
+		CoordinateFrame frame = studFrame(face, request.half, columns, rows);
+		buildStuds(columns, rows, frame, out);
+	}
+}
+
+// A run of requests for one worker
+struct MeshBatch
+{
+	const MeshRequest* requests;
+	BrickMesh* meshes;
+	int count;
+};
+
+static void buildBatch(void* arg)
+{
+	MeshBatch* batch = (MeshBatch*)arg;
+	for(int i = 0; i < batch->count; i++)
+	{
+		batch->meshes[i].clear();
+		BrickMeshBuilder::buildPart(batch->requests[i], batch->meshes[i]);
+	}
+}
+
+void BrickMeshBuilder::buildParts(WorkerPool* pool, const std::vector<MeshRequest>& requests, std::vector<BrickMesh>& meshes)
+{
+	meshes.resize(requests.size());
+	if(requests.empty())
+		return;
+	// Small batches so uneven parts (a baseplate's studs) balance out
+	const int batchSize = 64;
+	int count = (int)requests.size();
+	std::vector<MeshBatch> batches;
+	for(int start = 0; start < count; start += batchSize)
+	{
+		MeshBatch batch;
+		batch.requests = &requests[start];
+		batch.meshes = &meshes[start];
+		batch.count = start + batchSize < count ? batchSize : count - start;
+		batches.push_back(batch);
+	}
+	std::vector<void*> args(batches.size());
+	for(size_t i = 0; i < batches.size(); i++)
+		args[i] = &batches[i];
+	if(pool != NULL)
+		pool->run(buildBatch, &args[0], (int)args.size());
+	else
+	{
+		for(size_t i = 0; i < args.size(); i++)
+			buildBatch(args[i]);
+	}
+}
+
+static CoordinateFrame rotationFrame(const Vector3& axis, float degrees)
+{
+	return CoordinateFrame(Matrix3::fromAxisAngle(axis, (float)toRadians(degrees)), Vector3::zero());
+}
+
+// Same placement renderSurface builds with translateFace and glRotatef
+CoordinateFrame studFrame(int face, const Vector3& half, int& columns, int& rows)
+{
+	CoordinateFrame frame;
+	float x;
+	float y;
+	switch(face)
+	{
+	case TOP:
+		frame = CoordinateFrame(Vector3(0, half.y, 0)) * rotationFrame(Vector3::unitX(), 90);
+		x = half.x * 2;
+		y = half.z * 2;
+		break;
+	case BOTTOM:
+		frame = CoordinateFrame(Vector3(0, -half.y, 0)) * rotationFrame(Vector3::unitX(), -90);
+		x = half.x * 2;
+		y = half.z * 2;
+		break;
+	case LEFT:
+		frame = CoordinateFrame(Vector3(half.x, 0, 0)) * rotationFrame(Vector3::unitY(), -90);
+		x = half.z * 2;
+		y = half.y * 2;
+		break;
+	case RIGHT:
+		frame = CoordinateFrame(Vector3(-half.x, 0, 0)) * rotationFrame(Vector3::unitY(), 90);
+		x = half.z * 2;
+		y = half.y * 2;
+		break;
+	case FRONT:
+		frame = CoordinateFrame(Vector3(0, 0, half.z)) * rotationFrame(Vector3::unitY(), -180);
+		x = half.x * 2;
+		y = half.y * 2;
+		break;
+	default:
+		frame = CoordinateFrame(Vector3(0, 0, -half.z));
+		x = half.x * 2;
+		y = half.y * 2;
+		break;
+	}
+	frame = frame * rotationFrame(Vector3::unitX(), -90) * CoordinateFrame(Vector3(-x/2 + 0.5F, 0, -y/2 + 0.5F));
+	columns = (int)ceil(x);
+	rows = (int)ceil(y);
+	return frame;
+}
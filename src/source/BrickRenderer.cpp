@@ -0,0 +1,684 @@
+#include "BrickRenderer.h"
+#include "Renderer.h"
+#include "Faces.h"
+#include <algorithm>
+
+RenderStats::RenderStats()
+{
+	drawCalls = 0;
+	batchedParts = 0;
+	legacyParts = 0;
+	vertices = 0;
+	studs = 0;
+	chunks = 0;
+	bakedParts = 0;
+	for(int tier = 0; tier < BrickRenderer::lodTiers; tier++)
+		lodParts[tier] = 0;
+}
+
+Enum::SurfaceType::Value partSurface(PartInstance* part, int face)
+{
+	switch(face)
+	{
+	case TOP:
+		return part->top;
+	case BOTTOM:
+		return part->bottom;
+	case LEFT:
+		return part->left;
+	case RIGHT:
+		return part->right;
+	case FRONT:
+		return part->front;
+	default:
+		return part->back;
+	}
+}
+
+BrickRenderer::BrickRenderer()
+{
+	batching = true;
+	meshesBuilt = false;
+	studDistance = 32;
+	lod = true;
+	lodPixels[0] = 120;
+	lodPixels[1] = 30;
+	lodHysteresis = 0.25F;
+	projectionScale = 1;
+	chunkBuilder = NULL;
+}
+
+BrickRenderer::~BrickRenderer()
+{
+	clearStatic();
+}
+
+void BrickRenderer::setBatching(bool batching)
+{
+	this->batching = batching;
+}
+
+bool BrickRenderer::isBatching()
+{
+	return batching;
+}
+
+void BrickRenderer::setStudDistance(float distance)
+{
+	studDistance = distance;
+}
+
+float BrickRenderer::getStudDistance()
+{
+	return studDistance;
+}
+
+void BrickRenderer::setLod(bool lod)
+{
+	this->lod = lod;
+}
+
+bool BrickRenderer::isLod()
+{
+	return lod;
+}
+
+void BrickRenderer::setLodPixels(float medium, float low)
+{
+	lodPixels[0] = medium;
+	lodPixels[1] = low;
+}
+
+void BrickRenderer::setLodHysteresis(float hysteresis)
+{
+	lodHysteresis = hysteresis;
+}
+
+int BrickRenderer::pickTier(PartInstance* part, const Vector3& camera)
+{
+	if(!lod)
+		return 0;
+	// Pixels across the part's bounding sphere
+	float radius = (part->getSize() / 2).length();
+	float distance = (part->getRenderCFrame().translation - camera).length();
+	float pixels = distance > radius ? radius / distance * projectionScale : lodPixels[0] * 2;
+
+	// Step down as soon as the part falls under a threshold, but only step
+	// back up once it's clear of it, so parts on the line don't flicker
+	int tier = part->renderTier;
+	while(tier < lodTiers - 1 && pixels < lodPixels[tier])
+		tier++;
+	while(tier > 0 && pixels > lodPixels[tier - 1] * (1 + lodHysteresis))
+		tier--;
+	part->renderTier = tier;
+	return tier;
+}
+
+const RenderStats& BrickRenderer::getStats()
+{
+	return stats;
+}
+
+void BrickRenderer::addUnitMesh(const BrickMesh& mesh, std::vector<MeshVertex>& kind)
+{
+	for(size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		MeshVertex vertex;
+		vertex.sign = Vector3::zero();
+		vertex.offset = mesh.vertices[mesh.indices[i]];
+		vertex.normal = mesh.normals[mesh.indices[i]];
+		kind.push_back(vertex);
+	}
+}
+
+void BrickRenderer::buildMeshes()
+{
+	meshesBuilt = true;
+
+	const std::vector<BrickMeshBuilder::TemplateVertex>& block = BrickMeshBuilder::getBlockTemplate();
+	for(size_t i = 0; i < block.size(); i++)
+	{
+		MeshVertex vertex;
+		vertex.sign = block[i].sign;
+		vertex.offset = block[i].offset;
+		vertex.normal = block[i].normal;
+		meshes[BLOCK].push_back(vertex);
+	}
+
+	// Unit spheres: as finely cut as the gluSphere they replace, then coarser
+	BrickMesh mesh;
+	BrickMeshBuilder::buildBall(Vector3(1, 1, 1), 20, 20, mesh);
+	addUnitMesh(mesh, meshes[BALL]);
+	mesh.clear();
+	BrickMeshBuilder::buildBall(Vector3(1, 1, 1), 12, 10, mesh);
+	addUnitMesh(mesh, meshes[BALL_MEDIUM]);
+	mesh.clear();
+	BrickMeshBuilder::buildBall(Vector3(1, 1, 1), 8, 6, mesh);
+	addUnitMesh(mesh, meshes[BALL_LOW]);
+	mesh.clear();
+	BrickMeshBuilder::buildStuds(1, 1, CoordinateFrame(), mesh);
+	addUnitMesh(mesh, meshes[STUD]);
+
+	// Plain box for blocks too small on screen for their bevels to show
+	for(int axis = 0; axis < 3; axis++)
+	{
+		for(int side = -1; side <= 1; side += 2)
+		{
+			Vector3 normal = Vector3::zero();
+			normal[axis] = (float)side;
+			Vector3 u = Vector3::zero();
+			Vector3 v = Vector3::zero();
+			u[(axis + 1) % 3] = 1;
+			v[(axis + 2) % 3] = 1;
+			if(side < 0)
+				std::swap(u, v);
+			Vector3 corners[4] = {normal - u - v, normal + u - v, normal + u + v, normal - u + v};
+			const int triangles[6] = {0, 1, 2, 0, 2, 3};
+			for(int k = 0; k < 6; k++)
+			{
+				MeshVertex vertex;
+				vertex.sign = corners[triangles[k]];
+				vertex.offset = Vector3::zero();
+				vertex.normal = normal;
+				meshes[BLOCK_FLAT].push_back(vertex);
+			}
+		}
+	}
+
+	// A quad over the whole face in stud grid space, sized by columns and
+	// rows and raised a hair so it wins over the block's own face
+	const float corners[6][2] = {{0, 0}, {0, 1}, {1, 1}, {0, 0}, {1, 1}, {1, 0}};
+	for(int i = 0; i < 6; i++)
+	{
+		MeshVertex vertex;
+		vertex.sign = Vector3(corners[i][0], 0, corners[i][1]);
+		vertex.offset = Vector3(-0.5F, 0.005F, -0.5F);
+		vertex.normal = Vector3::unitY();
+		meshes[STUD_FACE].push_back(vertex);
+	}
+	buildStudTexture();
+}
+
+void BrickRenderer::buildStudTexture()
+{
+	// One stud per tile seen from above: the same 0.6 square the geometry
+	// uses, lit from the top left
+	const int size = 32;
+	uint8 pixels[size * size * 3];
+	int low = (int)(size * 0.2F);
+	int high = (int)(size * 0.8F) - 1;
+	for(int y = 0; y < size; y++)
+	{
+		for(int x = 0; x < size; x++)
+		{
+			uint8 shade = 235;
+			if(x >= low && x <= high && y >= low && y <= high)
+			{
+				shade = 255;
+				if(x == high || y == high)
+					shade = 160;
+				else if(x == low || y == low)
+					shade = 255;
+			}
+			uint8* pixel = &pixels[(y * size + x) * 3];
+			pixel[0] = pixel[1] = pixel[2] = shade;
+		}
+	}
+	studTexture = Texture::fromMemory("Studs", pixels, TextureFormat::RGB8, size, size, TextureFormat::AUTO, Texture::DIM_2D, Texture::Parameters::defaults());
+}
+
+bool BrickRenderer::canBatch(PartInstance* part)
+{
+	if(part->shape == Enum::Shape::Cylinder)
+		return false;
+	for(int face = 0; face < 6; face++)
+	{
+		Enum::SurfaceType::Value surface = partSurface(part, face);
+		if(surface == Enum::SurfaceType::Hinge || surface == Enum::SurfaceType::Motor)
+			return false;
+	}
+	return true;
+}
+
+void BrickRenderer::addPart(PartInstance* part, const Vector3& camera)
+{
+	int tier = pickTier(part, camera);
+	stats.lodParts[tier]++;
+	addBody(part, tier, instances);
+	if(tier == 0)
+		addStudGeometry(part, camera);
+}
+
+void BrickRenderer::addBody(PartInstance* part, int tier, Array<BrickInstance>* kinds)
+{
+	static const Kind ballKinds[lodTiers] = {BALL, BALL_MEDIUM, BALL_LOW};
+	static const Kind blockKinds[lodTiers] = {BLOCK, BLOCK_FLAT, BLOCK_FLAT};
+	Vector3 half = part->getSize() / 2;
+	BrickInstance& instance = kinds[part->shape == Enum::Shape::Ball ? ballKinds[tier] : blockKinds[tier]].next();
+	instance.cFrame = part->getRenderCFrame();
+	instance.size = half;
+	instance.color = part->color;
+
+	// The lowest tier leaves studs out altogether
+	if(tier == lodTiers - 1)
+		return;
+	for(int face = 0; face < 6; face++)
+	{
+		if(partSurface(part, face) != Enum::SurfaceType::Bumps)
+			continue;
+		int columns;
+		int rows;
+		BrickInstance& faceInstance = kinds[STUD_FACE].next();
+		faceInstance.cFrame = part->getRenderCFrame() * studFrame(face, half, columns, rows);
+		faceInstance.size = Vector3((float)columns, 0, (float)rows);
+		faceInstance.color = part->color;
+	}
+}
+
+void BrickRenderer::addStudGeometry(PartInstance* part, const Vector3& camera)
+{
+	Vector3 half = part->getSize() / 2;
+	for(int face = 0; face < 6; face++)
+	{
+		if(partSurface(part, face) != Enum::SurfaceType::Bumps)
+			continue;
+		int columns;
+		int rows;
+		CoordinateFrame frame = part->getRenderCFrame() * studFrame(face, half, columns, rows);
+
+		// Real studs only in the window of the grid near the camera. Nothing
+		// when the camera is behind the face or too far above it.
+		Vector3 eye = frame.pointToObjectSpace(camera);
+		if(eye.y <= 0 || eye.y >= studDistance)
+			continue;
+		float reach = sqrt(studDistance * studDistance - eye.y * eye.y);
+		int firstColumn = iMax(0, (int)floor(eye.x - reach));
+		int lastColumn = iMin(columns - 1, (int)ceil(eye.x + reach));
+		int firstRow = iMax(0, (int)floor(eye.z - reach));
+		int lastRow = iMin(rows - 1, (int)ceil(eye.z + reach));
+		for(int i = firstRow; i <= lastRow; i++)
+		{
+			for(int j = firstColumn; j <= lastColumn; j++)
+			{
+				BrickInstance& instance = instances[STUD].next();
+				instance.cFrame.rotation = frame.rotation;
+				instance.cFrame.translation = frame.pointToWorldSpace(Vector3((float)j, 0, (float)i));
+				instance.size = Vector3(1, 1, 1);
+				instance.color = part->color;
+				stats.studs++;
+			}
+		}
+	}
+}
+
+void BrickRenderer::expand(int kind, const Array<BrickInstance>& kindInstances, int start, Array<Vector3>& positions, Array<Vector3>& normals, Array<Color3>& colors, Array<Vector2>* texCoords) const
+{
+	const std::vector<MeshVertex>& mesh = meshes[kind];
+	int meshSize = (int)mesh.size();
+	int count = start + kindInstances.size() * meshSize;
+	positions.resize(count, false);
+	normals.resize(count, false);
+	colors.resize(count, false);
+	if(texCoords != NULL)
+		texCoords->resize(count, false);
+
+	int out = start;
+	for(int i = 0; i < kindInstances.size(); i++)
+	{
+		const BrickInstance& instance = kindInstances[i];
+		const Matrix3& rotation = instance.cFrame.rotation;
+		const Vector3& translation = instance.cFrame.translation;
+		// Balls scale evenly, blocks only move their vertices by the half size
+		float scale = kind == BALL || kind == BALL_MEDIUM || kind == BALL_LOW ? instance.size.x : 1.0F;
+		for(int j = 0; j < meshSize; j++, out++)
+		{
+			const MeshVertex& vertex = mesh[j];
+			Vector3 local = (vertex.sign * instance.size + vertex.offset) * scale;
+			positions[out] = rotation * local + translation;
+			normals[out] = rotation * vertex.normal;
+			colors[out] = instance.color;
+			if(texCoords != NULL)
+				(*texCoords)[out] = Vector2(local.x + 0.5F, local.z + 0.5F);
+		}
+	}
+}
+
+int BrickRenderer::legacyDrawCalls(PartInstance* part)
+{
+	// What the part's display list replays
+	int calls = part->shape == Enum::Shape::Cylinder ? 7 : 1;
+	for(int face = 0; face < 6; face++)
+	{
+		switch(partSurface(part, face))
+		{
+		case Enum::SurfaceType::Bumps:
+			calls++;
+			break;
+		case Enum::SurfaceType::Motor:
+			calls += 6;
+			break;
+		case Enum::SurfaceType::Hinge:
+			calls += 3;
+			break;
+		default:
+			break;
+		}
+	}
+	return calls;
+}
+
+// Builds a batch of chunks off the main thread. It only reads the snapshots
+// taken when the batch started and the unit meshes.
+class BrickRenderer::ChunkBuilder : public GThread
+{
+public:
+	ChunkBuilder(const BrickRenderer* renderer) : GThread("Chunk builder"), renderer(renderer)
+	{
+	}
+	std::vector<StaticChunk*> chunks;
+protected:
+	void threadMain()
+	{
+		for(size_t i = 0; i < chunks.size(); i++)
+			renderer->buildChunk(*chunks[i]);
+	}
+private:
+	const BrickRenderer* renderer;
+};
+
+BrickRenderer::StaticChunk::StaticChunk()
+{
+	dirty = false;
+	building = false;
+	ready = false;
+	solidVertices = 0;
+	faceVertices = 0;
+}
+
+void BrickRenderer::updateStatic(PartInstance* part)
+{
+	removeStatic(part);
+	if(!part->isAnchored() || part->isDragging() || !canBatch(part))
+		return;
+
+	Vector3 position = part->getCFrame().translation;
+	std::pair<int, int> cell((int)floor(position.x / chunkSize), (int)floor(position.z / chunkSize));
+	std::map<std::pair<int, int>, int>::iterator found = chunkCells.find(cell);
+	int id;
+	if(found == chunkCells.end())
+	{
+		id = (int)chunks.size();
+		chunks.push_back(new StaticChunk());
+		chunkCells[cell] = id;
+	}
+	else
+		id = found->second;
+	StaticChunk* chunk = chunks[id];
+	chunk->parts.push_back(part);
+	chunk->dirty = true;
+	chunk->ready = false;
+	part->renderChunk = id;
+}
+
+void BrickRenderer::removeStatic(PartInstance* part)
+{
+	if(part->renderChunk < 0)
+		return;
+	StaticChunk* chunk = chunks[part->renderChunk];
+	chunk->parts.erase(std::remove(chunk->parts.begin(), chunk->parts.end(), part), chunk->parts.end());
+	chunk->dirty = true;
+	chunk->ready = false;
+	part->renderChunk = -1;
+}
+
+void BrickRenderer::clearStatic()
+{
+	if(chunkBuilder != NULL)
+	{
+		chunkBuilder->waitForCompletion();
+		delete chunkBuilder;
+		chunkBuilder = NULL;
+	}
+	for(size_t i = 0; i < chunks.size(); i++)
+	{
+		for(size_t j = 0; j < chunks[i]->parts.size(); j++)
+			chunks[i]->parts[j]->renderChunk = -1;
+		delete chunks[i];
+	}
+	chunks.clear();
+	chunkCells.clear();
+}
+
+void BrickRenderer::buildChunk(StaticChunk& chunk) const
+{
+	chunk.solidPositions.fastClear();
+	chunk.solidNormals.fastClear();
+	chunk.solidColors.fastClear();
+	for(int kind = 0; kind < STUD_FACE; kind++)
+		expand(kind, chunk.instances[kind], chunk.solidPositions.size(), chunk.solidPositions, chunk.solidNormals, chunk.solidColors, NULL);
+	expand(STUD_FACE, chunk.instances[STUD_FACE], 0, chunk.facePositions, chunk.faceNormals, chunk.faceColors, &chunk.faceTexCoords);
+}
+
+void BrickRenderer::startChunkBuilds()
+{
+	if(chunkBuilder != NULL)
+	{
+		if(!chunkBuilder->completed())
+			return;
+		for(size_t i = 0; i < chunkBuilder->chunks.size(); i++)
+			uploadChunk(*chunkBuilder->chunks[i]);
+		delete chunkBuilder;
+		chunkBuilder = NULL;
+	}
+
+	// Snapshot every dirty chunk here, the builder never sees the parts
+	ChunkBuilder* builder = NULL;
+	for(size_t i = 0; i < chunks.size(); i++)
+	{
+		StaticChunk& chunk = *chunks[i];
+		if(!chunk.dirty)
+			continue;
+		chunk.dirty = false;
+		chunk.building = true;
+		chunk.bounds = AABox();
+		for(int kind = 0; kind < KIND_COUNT; kind++)
+			chunk.instances[kind].fastClear();
+		for(size_t j = 0; j < chunk.parts.size(); j++)
+		{
+			PartInstance* part = chunk.parts[j];
+			addBody(part, 0, chunk.instances);
+			Vector3 half = part->getSize() / 2 + Vector3(0.2F, 0.2F, 0.2F);
+			AABox bounds;
+			part->getRenderCFrame().toWorldSpace(Box(-half, half)).getBounds(bounds);
+			chunk.bounds = j == 0 ? bounds : AABox(bounds.low().min(chunk.bounds.low()), bounds.high().max(chunk.bounds.high()));
+		}
+		if(builder == NULL)
+			builder = new ChunkBuilder(this);
+		builder->chunks.push_back(&chunk);
+	}
+	if(builder != NULL)
+	{
+		chunkBuilder = builder;
+		chunkBuilder->start();
+	}
+}
+
+void BrickRenderer::uploadChunk(StaticChunk& chunk)
+{
+	chunk.building = false;
+	chunk.solidVertices = chunk.solidPositions.size();
+	chunk.faceVertices = chunk.facePositions.size();
+	if(chunk.solidVertices + chunk.faceVertices > 0)
+	{
+		size_t bytes = (chunk.solidVertices + chunk.faceVertices) * (sizeof(Vector3) * 2 + sizeof(Color3)) + chunk.faceVertices * sizeof(Vector2) + 7 * 16;
+		if(chunk.varArea.isNull() || chunk.varArea->totalSize() < bytes)
+			chunk.varArea = VARArea::create(bytes, VARArea::WRITE_ONCE);
+		else
+			chunk.varArea->reset();
+		if(chunk.solidVertices > 0)
+		{
+			chunk.solidVertexArray = VAR(chunk.solidPositions, chunk.varArea);
+			chunk.solidNormalArray = VAR(chunk.solidNormals, chunk.varArea);
+			chunk.solidColorArray = VAR(chunk.solidColors, chunk.varArea);
+		}
+		if(chunk.faceVertices > 0)
+		{
+			chunk.faceVertexArray = VAR(chunk.facePositions, chunk.varArea);
+			chunk.faceNormalArray = VAR(chunk.faceNormals, chunk.varArea);
+			chunk.faceColorArray = VAR(chunk.faceColors, chunk.varArea);
+			chunk.faceTexCoordArray = VAR(chunk.faceTexCoords, chunk.varArea);
+		}
+	}
+	// The copies are on the card now
+	chunk.solidPositions.clear();
+	chunk.solidNormals.clear();
+	chunk.solidColors.clear();
+	chunk.facePositions.clear();
+	chunk.faceNormals.clear();
+	chunk.faceColors.clear();
+	chunk.faceTexCoords.clear();
+	for(int kind = 0; kind < KIND_COUNT; kind++)
+		chunk.instances[kind].clear();
+	// Edited again while it was building, so it waits for the next batch
+	chunk.ready = !chunk.dirty;
+}
+
+bool BrickRenderer::isBaked(PartInstance* part)
+{
+	return part->renderChunk >= 0 && chunks[part->renderChunk]->ready;
+}
+
+void BrickRenderer::queueChunks(const Vector3& camera, const Array<Plane>* clipPlanes)
+{
+	for(size_t i = 0; i < chunks.size(); i++)
+	{
+		StaticChunk& chunk = *chunks[i];
+		if(!chunk.ready || chunk.solidVertices + chunk.faceVertices == 0)
+			continue;
+		if(clipPlanes != NULL && chunk.bounds.culledBy(*clipPlanes))
+			continue;
+		stats.chunks++;
+		stats.bakedParts += (int)chunk.parts.size();
+
+		if(chunk.solidVertices > 0)
+		{
+			DrawArrays solid;
+			solid.area = chunk.varArea;
+			solid.vertices = chunk.solidVertexArray;
+			solid.normals = chunk.solidNormalArray;
+			solid.colors = chunk.solidColorArray;
+			solid.count = chunk.solidVertices;
+			queue.addArrays(BLOCK, RenderQueue::PLASTIC, NULL, solid);
+			stats.drawCalls++;
+		}
+		if(chunk.faceVertices > 0)
+		{
+			DrawArrays faces;
+			faces.area = chunk.varArea;
+			faces.vertices = chunk.faceVertexArray;
+			faces.normals = chunk.faceNormalArray;
+			faces.colors = chunk.faceColorArray;
+			faces.texCoords = chunk.faceTexCoordArray;
+			faces.count = chunk.faceVertices;
+			queue.addArrays(STUD_FACE, RenderQueue::PLASTIC_DECAL, studTexture, faces);
+			stats.drawCalls++;
+		}
+		stats.vertices += chunk.solidVertices + chunk.faceVertices;
+
+		// Studs near the camera can't be baked, they go out with this frame's
+		// batch like everyone else's
+		Vector3 nearest = chunk.bounds.low().max(camera.min(chunk.bounds.high()));
+		if((nearest - camera).length() < studDistance)
+		{
+			for(size_t j = 0; j < chunk.parts.size(); j++)
+				addStudGeometry(chunk.parts[j], camera);
+		}
+	}
+}
+
+void BrickRenderer::queueLegacy(PartInstance* part)
+{
+	// Sorted after every batched kind, by the part's shape
+	queue.addList(KIND_COUNT + part->shape, RenderQueue::PLASTIC, part->getMeshList(), part->getRenderCFrame(), part->color);
+	stats.legacyParts++;
+	stats.drawCalls += legacyDrawCalls(part);
+}
+
+void BrickRenderer::render(RenderDevice* rd, const std::vector<PartInstance*>& parts, const Array<Plane>* clipPlanes)
+{
+	stats = RenderStats();
+	if(!meshesBuilt)
+		buildMeshes();
+	queue.clear();
+
+	if(!batching)
+	{
+		for(size_t i = 0; i < parts.size(); i++)
+			queueLegacy(parts[i]);
+		queue.submit(rd, false);
+		stats.stateChanges = queue.getStateChanges();
+		return;
+	}
+
+	startChunkBuilds();
+	legacyParts.clear();
+	for(int kind = 0; kind < KIND_COUNT; kind++)
+		instances[kind].fastClear();
+	Vector3 camera = rd->getCameraToWorldMatrix().translation;
+	projectionScale = rd->getProjectionMatrix()[1][1] * rd->getViewport().height() / 2;
+	queueChunks(camera, clipPlanes);
+
+	for(size_t i = 0; i < parts.size(); i++)
+	{
+		if(isBaked(parts[i]))
+			continue;
+		if(canBatch(parts[i]))
+		{
+			addPart(parts[i], camera);
+			stats.batchedParts++;
+		}
+		else
+			legacyParts.push_back(parts[i]);
+	}
+
+	int total = 0;
+	for(int kind = 0; kind < KIND_COUNT; kind++)
+		total += instances[kind].size() * (int)meshes[kind].size();
+	if(total > 0)
+	{
+		// Room for every kind's arrays plus alignment slack
+		size_t bytes = total * (sizeof(Vector3) * 2 + sizeof(Color3)) + KIND_COUNT * 4 * 16 + 8;
+		bytes += instances[STUD_FACE].size() * meshes[STUD_FACE].size() * sizeof(Vector2);
+		if(varArea.isNull() || varArea->totalSize() < bytes)
+			varArea = VARArea::create(bytes + bytes / 2, VARArea::WRITE_EVERY_FRAME);
+		else
+			varArea->reset();
+
+		for(int kind = 0; kind < KIND_COUNT; kind++)
+		{
+			if(instances[kind].size() == 0)
+				continue;
+			bool textured = kind == STUD_FACE;
+			expand(kind, instances[kind], 0, positions, normals, colors, textured ? &texCoords : NULL);
+			DrawArrays arrays;
+			arrays.area = varArea;
+			arrays.vertices = VAR(positions, varArea);
+			arrays.normals = VAR(normals, varArea);
+			arrays.colors = VAR(colors, varArea);
+			if(textured)
+				arrays.texCoords = VAR(texCoords, varArea);
+			arrays.count = positions.size();
+			if(textured)
+				queue.addArrays(kind, RenderQueue::PLASTIC_DECAL, studTexture, arrays);
+			else
+				queue.addArrays(kind, RenderQueue::PLASTIC, NULL, arrays);
+			stats.drawCalls++;
+		}
+		stats.vertices += total;
+	}
+
+	for(size_t i = 0; i < legacyParts.size(); i++)
+		queueLegacy(legacyParts[i]);
+	queue.submit(rd);
+	stats.stateChanges = queue.getStateChanges();
+}
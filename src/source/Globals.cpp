@@ -6,6 +6,7 @@ std::vector<Instance*> postRenderStack = std::vector<Instance*>();
 
 DataModelManager* g_dataModel = NULL;
 XplicitNgine* g_xplicitNgine = NULL;
+PhysicsRecorder* g_physicsRecorder = NULL;
 
 bool running = false;
 POINT Globals::mousepoint;
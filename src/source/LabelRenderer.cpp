@@ -0,0 +1,207 @@
+#include "LabelRenderer.h"
+#include <algorithm>
+
+LabelRenderer::LabelRenderer(const std::string& fontFile)
+{
+	this->fontFile = fontFile;
+	fontLoaded = false;
+	charWidth = 1;
+	charHeight = 1;
+	for(int c = 0; c < 128; c++)
+		glyphWidths[c] = 0;
+	maxDistance = 100;
+	labelCount = 0;
+	glyphCount = 0;
+}
+
+void LabelRenderer::setMaxDistance(float distance)
+{
+	maxDistance = distance;
+}
+
+float LabelRenderer::getMaxDistance()
+{
+	return maxDistance;
+}
+
+int LabelRenderer::getLabelCount()
+{
+	return labelCount;
+}
+
+int LabelRenderer::getGlyphCount()
+{
+	return glyphCount;
+}
+
+bool LabelRenderer::loadFont()
+{
+	// Tried once, a missing font leaves the labels off
+	fontLoaded = true;
+	if(!fileExists(fontFile))
+		return false;
+	// The layout GFont reads: version, glyph widths, baseline, then a 16 by 8
+	// grid of alpha glyphs
+	BinaryInput b(fontFile, G3D_LITTLE_ENDIAN, true);
+	if(b.readInt32() != 1)
+		return false;
+	for(int c = 0; c < 128; c++)
+		glyphWidths[c] = b.readUInt16();
+	b.readUInt16();
+	int texWidth = b.readUInt16();
+	charWidth = texWidth / 16;
+	charHeight = texWidth / 16;
+	int width = ceilPow2(charWidth * 16);
+	int height = ceilPow2(charHeight * 8);
+	const uint8* pixels = b.getCArray() + b.getPosition();
+	Texture::Settings settings;
+	settings.wrapMode = Texture::CLAMP;
+	fontTexture = Texture::fromMemory(fontFile, pixels, TextureFormat::A8, width, height, TextureFormat::A8, Texture::DIM_2D, settings);
+	return true;
+}
+
+bool LabelRenderer::fartherFirst(const Label& a, const Label& b)
+{
+	return a.distance > b.distance;
+}
+
+float LabelRenderer::stringWidth(const std::string& s, float w) const
+{
+	float propW = w / charWidth;
+	float width = 0;
+	for(size_t i = 0; i < s.length(); i++)
+		width += propW * glyphWidths[s[i] & 127];
+	return width;
+}
+
+void LabelRenderer::addString(const std::string& s, const Vector3& origin, const Vector3& right, const Vector3& up, float x, float y, float w, float h, const Color4& color)
+{
+	float propW = w / charWidth;
+	// Pulled in a texel top and bottom so mipmapping doesn't bleed the
+	// neighbouring rows in
+	float sy = h / charHeight;
+	float texelX = 1.0F / fontTexture->getTexelWidth();
+	float texelY = 1.0F / fontTexture->getTexelHeight();
+	for(size_t i = 0; i < s.length(); i++)
+	{
+		int c = s[i] & 127;
+		if(c != ' ')
+		{
+			int row = c / 16;
+			int col = c & 15;
+			float left = x - (charWidth - glyphWidths[c]) * propW * 0.5F;
+			float top = y + sy;
+			float bottom = y + h - sy;
+			float u0 = col * charWidth * texelX;
+			float u1 = ((col + 1) * charWidth - 1) * texelX;
+			float v0 = (row * charHeight + 1) * texelY;
+			float v1 = ((row + 1) * charHeight - 2) * texelY;
+
+			positions.append(origin + right * left - up * top);
+			texCoords.append(Vector2(u0, v0));
+			positions.append(origin + right * left - up * bottom);
+			texCoords.append(Vector2(u0, v1));
+			positions.append(origin + right * (left + w) - up * bottom);
+			texCoords.append(Vector2(u1, v1));
+			positions.append(origin + right * (left + w) - up * top);
+			texCoords.append(Vector2(u1, v0));
+			for(int corner = 0; corner < 4; corner++)
+				colors.append(color);
+			glyphCount++;
+		}
+		x += propW * glyphWidths[c];
+	}
+}
+
+void LabelRenderer::render(RenderDevice* rd, const std::vector<PartInstance*>& parts, const Array<Plane>& clipPlanes)
+{
+	labelCount = 0;
+	glyphCount = 0;
+	if(!fontLoaded)
+		loadFont();
+	if(fontTexture.isNull())
+		return;
+
+	CoordinateFrame camera = rd->getCameraToWorldMatrix();
+	labels.clear();
+	for(size_t i = 0; i < parts.size(); i++)
+	{
+		PartInstance* part = parts[i];
+		if(!part->nameShown || part->name.empty())
+			continue;
+		Label label;
+		label.part = part;
+		label.position = part->getRenderCFrame().translation + Vector3(0, 1.5F, 0);
+		float squared = (label.position - camera.translation).squaredLength();
+		if(squared >= maxDistance * maxDistance)
+			continue;
+		label.distance = sqrt(squared);
+		labels.push_back(label);
+	}
+	if(labels.empty())
+		return;
+	// Drawn without depth, so nearer labels have to go on top
+	std::sort(labels.begin(), labels.end(), fartherFirst);
+
+	positions.fastClear();
+	texCoords.fastClear();
+	colors.fastClear();
+	Vector3 right = camera.rotation.getColumn(0);
+	Vector3 up = camera.rotation.getColumn(1);
+	float bright = (float)rd->getBrightScale();
+	Color4 text(Color3::yellow() * bright, 1);
+	Color4 border(Color3::black(), 1);
+	for(size_t i = 0; i < labels.size(); i++)
+	{
+		const Label& label = labels[i];
+		// Grows with distance so every label is the same size on screen
+		float size = 0.03F * label.distance;
+		float h = size * 1.5F;
+		float w = h * charWidth / charHeight;
+		float width = stringWidth(label.part->name, w);
+		if(Sphere(label.position, width / 2 + h).culledBy(clipPlanes))
+			continue;
+		float x = -width / 2;
+		float y = -h / 2;
+		// A pixel's worth of black each way under the text
+		float offset = size / 12;
+		for(int dy = -1; dy <= 1; dy += 2)
+		{
+			for(int dx = -1; dx <= 1; dx += 2)
+				addString(label.part->name, label.position, right, up, x + dx * offset, y + dy * offset, w, h, border);
+		}
+		addString(label.part->name, label.position, right, up, x, y, w, h, text);
+		labelCount++;
+	}
+	if(positions.size() == 0)
+		return;
+
+	size_t bytes = positions.size() * (sizeof(Vector3) + sizeof(Vector2) + sizeof(Color4)) + 3 * 16 + 8;
+	if(varArea.isNull() || varArea->totalSize() < bytes)
+		varArea = VARArea::create(bytes + bytes / 2, VARArea::WRITE_EVERY_FRAME);
+	else
+		varArea->reset();
+	VAR vertexArray(positions, varArea);
+	VAR texCoordArray(texCoords, varArea);
+	VAR colorArray(colors, varArea);
+
+	rd->pushState();
+	rd->setObjectToWorldMatrix(CoordinateFrame());
+	rd->setCullFace(RenderDevice::CULL_NONE);
+	rd->setTexture(0, fontTexture);
+	rd->setTextureCombineMode(0, RenderDevice::TEX_MODULATE);
+	rd->setBlendFunc(RenderDevice::BLEND_SRC_ALPHA, RenderDevice::BLEND_ONE_MINUS_SRC_ALPHA);
+	rd->setAlphaTest(RenderDevice::ALPHA_GEQUAL, 0.05);
+	rd->disableLighting();
+	rd->setDepthTest(RenderDevice::DEPTH_ALWAYS_PASS);
+	rd->disableDepthWrite();
+	rd->beginIndexedPrimitives();
+	// The scene pass leaves the normal array switched on
+	glDisableClientState(GL_NORMAL_ARRAY);
+	rd->setVertexArray(vertexArray);
+	rd->setTexCoordArray(0, texCoordArray);
+	rd->setColorArray(colorArray);
+	rd->sendSequentialIndices(RenderDevice::QUADS, positions.size());
+	rd->endIndexedPrimitives();
+	rd->popState();
+}
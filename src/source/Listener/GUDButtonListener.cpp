@@ -17,6 +17,7 @@ void GUDButtonListener::onButton1MouseClick(BaseButtonInstance* button)
 	if(cont)
 	{
 		AudioPlayer::playSound(dingSound);
+		g_dataModel->getEngine()->beginMutations();
 		if(button->name == "Duplicate")
 		{
 			std::vector<Instance*> newinst;
@@ -71,5 +72,6 @@ void GUDButtonListener::onButton1MouseClick(BaseButtonInstance* button)
 			g_dataModel->getSelectionService()->clearSelection();
 			g_dataModel->getSelectionService()->addSelected(newinst);
 		}
+		g_dataModel->getEngine()->commitMutations();
 	}
 }
\ No newline at end of file
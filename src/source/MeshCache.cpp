@@ -0,0 +1,101 @@
+#include "MeshCache.h"
+#include "Renderer.h"
+#include "Faces.h"
+
+std::map<MeshKey, MeshCache::Entry> MeshCache::entries;
+int MeshCache::references = 0;
+
+MeshKey::MeshKey()
+{
+	shape = 0;
+	size[0] = size[1] = size[2] = 0;
+	for(int face = 0; face < 6; face++)
+		surfaces[face] = 0;
+	controller = 0;
+}
+
+MeshKey::MeshKey(Enum::Shape::Value shape, const Vector3& size, const Enum::SurfaceType::Value surfaces[6], Enum::Controller::Value controller)
+{
+	this->shape = shape;
+	for(int axis = 0; axis < 3; axis++)
+		this->size[axis] = (int)floor(size[axis] * 100 + 0.5F);
+	bool motor = false;
+	for(int face = 0; face < 6; face++)
+	{
+		this->surfaces[face] = surfaces[face];
+		if(surfaces[face] == Enum::SurfaceType::Motor)
+			motor = true;
+	}
+	this->controller = motor ? controller : 0;
+}
+
+bool MeshKey::operator<(const MeshKey& other) const
+{
+	if(shape != other.shape)
+		return shape < other.shape;
+	for(int axis = 0; axis < 3; axis++)
+	{
+		if(size[axis] != other.size[axis])
+			return size[axis] < other.size[axis];
+	}
+	for(int face = 0; face < 6; face++)
+	{
+		if(surfaces[face] != other.surfaces[face])
+			return surfaces[face] < other.surfaces[face];
+	}
+	return controller < other.controller;
+}
+
+bool MeshKey::operator==(const MeshKey& other) const
+{
+	return !(*this < other) && !(other < *this);
+}
+
+GLuint MeshCache::acquire(const MeshKey& key)
+{
+	references++;
+	std::map<MeshKey, Entry>::iterator found = entries.find(key);
+	if(found != entries.end())
+	{
+		found->second.references++;
+		return found->second.list;
+	}
+
+	Vector3 renderSize = Vector3(key.size[0], key.size[1], key.size[2]) / 200;
+	Entry entry;
+	entry.list = glGenLists(1);
+	entry.references = 1;
+	// Without the colour array the list takes whatever colour is current
+	glDisableClientState(GL_COLOR_ARRAY);
+	glNewList(entry.list, GL_COMPILE);
+	renderShape((Enum::Shape::Value)key.shape, renderSize);
+	const int faces[6] = {TOP, FRONT, RIGHT, BACK, LEFT, BOTTOM};
+	for(int i = 0; i < 6; i++)
+		renderSurface(faces[i], (Enum::SurfaceType::Value)key.surfaces[faces[i]], renderSize, (Enum::Controller::Value)key.controller);
+	glEndList();
+	glEnableClientState(GL_COLOR_ARRAY);
+	entries[key] = entry;
+	return entry.list;
+}
+
+void MeshCache::release(const MeshKey& key)
+{
+	std::map<MeshKey, Entry>::iterator found = entries.find(key);
+	if(found == entries.end())
+		return;
+	references--;
+	if(--found->second.references > 0)
+		return;
+	glDeleteLists(found->second.list, 1);
+	entries.erase(found);
+}
+
+int MeshCache::getMeshCount()
+{
+	return (int)entries.size();
+}
+
+int MeshCache::getReferenceCount()
+{
+	return references;
+}
@@ -0,0 +1,192 @@
+#include "RenderQueue.h"
+#include <algorithm>
+
+StateChanges::StateChanges()
+{
+	materials = 0;
+	textures = 0;
+	buffers = 0;
+	transforms = 0;
+	colors = 0;
+}
+
+int StateChanges::total() const
+{
+	return materials + textures + buffers + transforms + colors;
+}
+
+DrawArrays::DrawArrays()
+{
+	count = 0;
+}
+
+RenderQueue::RenderQueue()
+{
+}
+
+void RenderQueue::clear()
+{
+	items.clear();
+}
+
+void RenderQueue::addArrays(int shape, Material material, const TextureRef& texture, const DrawArrays& arrays)
+{
+	if(arrays.count == 0)
+		return;
+	DrawItem item;
+	item.shape = shape;
+	item.material = material;
+	item.texture = texture;
+	item.arrays = arrays;
+	item.list = 0;
+	items.push_back(item);
+}
+
+void RenderQueue::addList(int shape, Material material, GLuint list, const CoordinateFrame& cFrame, const Color3& color)
+{
+	DrawItem item;
+	item.shape = shape;
+	item.material = material;
+	item.list = list;
+	item.cFrame = cFrame;
+	item.color = color;
+	items.push_back(item);
+}
+
+int RenderQueue::size() const
+{
+	return (int)items.size();
+}
+
+const StateChanges& RenderQueue::getStateChanges() const
+{
+	return stateChanges;
+}
+
+bool RenderQueue::drawsBefore(const DrawItem* a, const DrawItem* b)
+{
+	if(a->material != b->material)
+		return a->material < b->material;
+	if(a->texture != b->texture)
+		return a->texture.pointer() < b->texture.pointer();
+	if(a->arrays.area != b->arrays.area)
+		return a->arrays.area.pointer() < b->arrays.area.pointer();
+	if(a->shape != b->shape)
+		return a->shape < b->shape;
+	if(a->list != b->list)
+		return a->list < b->list;
+	// Same mesh, group by colour so glColor is skipped between them
+	if(a->color.r != b->color.r)
+		return a->color.r < b->color.r;
+	if(a->color.g != b->color.g)
+		return a->color.g < b->color.g;
+	return a->color.b < b->color.b;
+}
+
+void RenderQueue::setMaterial(RenderDevice* rd, Material material)
+{
+	GLfloat specular[] = {0.4F, 0.4F, 0.4F, 0.4F};
+	GLfloat shininess[] = {100.0F};
+	glMaterialfv(GL_FRONT, GL_SPECULAR, specular);
+	glMaterialfv(GL_FRONT, GL_SHININESS, shininess);
+	rd->setPolygonOffset(material == PLASTIC_DECAL ? -1 : 0);
+	stateChanges.materials++;
+}
+
+void RenderQueue::submit(RenderDevice* rd, bool sort)
+{
+	stateChanges = StateChanges();
+	order.resize(items.size());
+	for(size_t i = 0; i < items.size(); i++)
+		order[i] = &items[i];
+	if(sort)
+		std::sort(order.begin(), order.end(), drawsBefore);
+
+	// What the last draw left set. The device is assumed to start with no
+	// texture, anything else is set before the first draw that needs it.
+	int material = -1;
+	TextureRef texture;
+	// Buffer of the open indexed primitive block, NULL while none is
+	VARArea* area = NULL;
+	bool texCoords = false;
+	bool identity = false;
+	bool colorSet = false;
+	Color3 color;
+	for(size_t i = 0; i < order.size(); i++)
+	{
+		const DrawItem& item = *order[i];
+		if(item.material != material)
+		{
+			setMaterial(rd, item.material);
+			material = item.material;
+		}
+		if(item.texture != texture)
+		{
+			rd->setTexture(0, item.texture);
+			texture = item.texture;
+			stateChanges.textures++;
+		}
+
+		if(item.list == 0)
+		{
+			const DrawArrays& arrays = item.arrays;
+			bool textured = arrays.texCoords.valid();
+			// A texture coordinate array can only be switched off by closing
+			// the block, or an untextured draw would read past its end
+			if(arrays.area.pointer() != area || (texCoords && !textured))
+			{
+				if(area != NULL)
+					rd->endIndexedPrimitives();
+				rd->beginIndexedPrimitives();
+				area = arrays.area.pointer();
+				texCoords = false;
+				stateChanges.buffers++;
+			}
+			if(!identity)
+			{
+				rd->setObjectToWorldMatrix(CoordinateFrame());
+				identity = true;
+				stateChanges.transforms++;
+			}
+			rd->setVertexArray(arrays.vertices);
+			rd->setNormalArray(arrays.normals);
+			rd->setColorArray(arrays.colors);
+			if(textured)
+			{
+				rd->setTexCoordArray(0, arrays.texCoords);
+				texCoords = true;
+			}
+			rd->sendSequentialIndices(RenderDevice::TRIANGLES, arrays.count);
+			// The colour array leaves the current colour undefined
+			colorSet = false;
+		}
+		else
+		{
+			if(area != NULL)
+			{
+				rd->endIndexedPrimitives();
+				area = NULL;
+			}
+			rd->setObjectToWorldMatrix(item.cFrame);
+			identity = false;
+			stateChanges.transforms++;
+			if(!colorSet || item.color != color)
+			{
+				glColor(item.color);
+				color = item.color;
+				colorSet = true;
+				stateChanges.colors++;
+			}
+			glCallList(item.list);
+		}
+	}
+	if(area != NULL)
+		rd->endIndexedPrimitives();
+	if(texture.notNull())
+	{
+		rd->setTexture(0, NULL);
+		stateChanges.textures++;
+	}
+	if(material == PLASTIC_DECAL)
+		rd->setPolygonOffset(0);
+}
@@ -1,198 +1,16 @@
 #include "Renderer.h"
 #include <G3DAll.h>
 #include "Faces.h"
-
-float _bevelSize = 0.05F;
-std::vector<Vector3> _debugUniqueVertices;
-std::vector<GLfloat> _vertices;
-std::vector<GLfloat> _normals;
-std::vector<GLushort> _indices;
-Color3 color;
-
-void addVertex(const Vector3& vertexPos,const Color3& color)
-{
-	_vertices.push_back(vertexPos.x);
-	_vertices.push_back(vertexPos.y);
-	_vertices.push_back(vertexPos.z);
-	_vertices.push_back(color.r);
-	_vertices.push_back(color.g);
-	_vertices.push_back(color.b);
-}
-
- void addNormals(const Vector3& normal)
-{
-	for (unsigned int i=0;i<3;i+=1) {
-		_normals.push_back(normal.x);
-		_normals.push_back(normal.y);
-		_normals.push_back(normal.z);
-	}
-}
- void addSingularNormal(const Vector3& normal)
-{
-		_normals.push_back(normal.x);
-		_normals.push_back(normal.y);
-		_normals.push_back(normal.z);
-}
- void addTriangle(const Vector3& v1, const Vector3& v2, const Vector3& v3)
-{
-	addVertex(v1,color);
-	addVertex(v2,color);
-	addVertex(v3,color);
-	//addNormals(cross(v2-v1,v3-v1).direction());
-	addSingularNormal(cross(v2-v1,v3-v1).direction());
-	addSingularNormal(cross(v3-v2,v1-v2).direction());
-	addSingularNormal(cross(v1-v3,v2-v3).direction());
-}
-
-void addQuad(const Vector3& v1, const Vector3& v2, const Vector3& v3, const Vector3& v4)
-{
-	addTriangle(v1, v2, v3);
-	addTriangle(v1, v3, v4);
-}
-
-void makeFace(int vertex1,int vertex2, int vertex3)
-{
-	addTriangle(Vector3(_vertices[vertex1],_vertices[vertex1+1],_vertices[vertex1+2]),
-		Vector3(_vertices[vertex2],_vertices[vertex2+1],_vertices[vertex2+2]),
-		Vector3(_vertices[vertex3],_vertices[vertex3+1],_vertices[vertex3+2]));
-}
-
-// Moved from the renderer function. 
-void drawBevels() 
-{
-	// Bevel Top Front
-	makeFace(0,36,48);
-	makeFace(48,18,0);
-	// Bevel Left Front Corner
-	makeFace(18,156,162);
-	makeFace(24,18,162);
-	// Bevel Left Front Top Corner
-	makeFace(48,156,18);
-	// Bevel Left Front Bottom Corner
-	makeFace(120,6,150);
-	// Bevel Left Top
-	makeFace(48,66,156);
-	makeFace(144,156,66);
-	// Bevel Bottom
-	makeFace(6,120,114);
-	makeFace(114,12,6);
-	// Left Bottom
-	makeFace(120,150,174);
-	makeFace(174,132,120);
-	// Right Front Top Corner
-	makeFace(36,0,180);
-	// Right Front Corner
-	makeFace(180,0,12);
-	makeFace(186,180,12);
-	// Right Front Bottom Corner
-	makeFace(186,12,114);
-	// Right Bottom
-	makeFace(186,114,108);
-	makeFace(108,198,186);
-	// Right Top Corner
-	makeFace(180,192,36);
-	makeFace(192,42,36);
-	// Right Back Top Corner
-	makeFace(72,42,192);
-	// Right Back Bottom Corner
-	makeFace(78,198,108);
-	// Right Back Corner
-	makeFace(72,192,198);
-	makeFace(198,78,72);
-	// Back Bottom Corner
-	makeFace(78,108,132);
-	makeFace(132,84,78);
-	// Back Top
-	makeFace(42,72,102);
-	makeFace(102,66,42);
-	// Back Left Top Corner
-	makeFace(144,66,102);
-	// Back Left Corner
-	makeFace(144,102,84);
-	makeFace(84,174,144);
-	// Back Left Bottom Corner
-	makeFace(174,84,132);
-	for (unsigned short i=0;i<_vertices.size()/6;i++) {
-		_indices.push_back(i);
-	}
-}
+#include "BrickMeshBuilder.h"
 
 void renderBlock(const Vector3& renderSize)
 {
-	addTriangle(Vector3(renderSize.x-_bevelSize,renderSize.y-_bevelSize,renderSize.z),
-					Vector3(-renderSize.x+_bevelSize,-renderSize.y+_bevelSize,renderSize.z),
-					Vector3(renderSize.x-_bevelSize,-renderSize.y+_bevelSize,renderSize.z)
-					);
-
-				addTriangle(Vector3(-renderSize.x+_bevelSize,renderSize.y-_bevelSize,renderSize.z),
-					Vector3(-renderSize.x+_bevelSize,-renderSize.y+_bevelSize,renderSize.z),
-					Vector3(renderSize.x-_bevelSize,renderSize.y-_bevelSize,renderSize.z)
-					);
-
-				// Top
-				addTriangle(Vector3(renderSize.x-_bevelSize,renderSize.y,renderSize.z-_bevelSize),
-					Vector3(renderSize.x-_bevelSize,renderSize.y,-renderSize.z+_bevelSize),
-					Vector3(-renderSize.x+_bevelSize,renderSize.y,renderSize.z-_bevelSize)
-					);
-				addTriangle(Vector3(-renderSize.x+_bevelSize,renderSize.y,renderSize.z-_bevelSize),
-					Vector3(renderSize.x-_bevelSize,renderSize.y,-renderSize.z+_bevelSize),
-					Vector3(-renderSize.x+_bevelSize,renderSize.y,-renderSize.z+_bevelSize)
-					);
+		BrickMesh mesh;
+		BrickMeshBuilder::buildBlock(renderSize, mesh);
 
-				// Back
-				addTriangle(Vector3(renderSize.x-_bevelSize,renderSize.y-_bevelSize,-renderSize.z),
-					Vector3(renderSize.x-_bevelSize,-renderSize.y+_bevelSize,-renderSize.z),
-					Vector3(-renderSize.x+_bevelSize,-renderSize.y+_bevelSize,-renderSize.z)
-					);
-				addTriangle(Vector3(renderSize.x-_bevelSize,renderSize.y-_bevelSize,-renderSize.z),
-					Vector3(-renderSize.x+_bevelSize,-renderSize.y+_bevelSize,-renderSize.z),
-					Vector3(-renderSize.x+_bevelSize,renderSize.y-_bevelSize,-renderSize.z)
-					);
-
-				// Bottom
-				addTriangle(Vector3(renderSize.x-_bevelSize,-renderSize.y,-renderSize.z+_bevelSize),
-					Vector3(renderSize.x-_bevelSize,-renderSize.y,renderSize.z-_bevelSize),
-					Vector3(-renderSize.x+_bevelSize,-renderSize.y,renderSize.z-_bevelSize)
-					);
-				addTriangle(Vector3(-renderSize.x+_bevelSize,-renderSize.y,renderSize.z-_bevelSize),
-					Vector3(-renderSize.x+_bevelSize,-renderSize.y,-renderSize.z+_bevelSize),
-					Vector3(renderSize.x-_bevelSize,-renderSize.y,-renderSize.z+_bevelSize)
-					);
- 				// Left
-				addTriangle(Vector3(-renderSize.x,renderSize.y-_bevelSize,-renderSize.z+_bevelSize),
-					Vector3(-renderSize.x,-renderSize.y+_bevelSize,renderSize.z-_bevelSize),
-					Vector3(-renderSize.x,renderSize.y-_bevelSize,renderSize.z-_bevelSize)
-					);
-				addTriangle(Vector3(-renderSize.x,-renderSize.y+_bevelSize,renderSize.z-_bevelSize),
-					Vector3(-renderSize.x,renderSize.y-_bevelSize,-renderSize.z+_bevelSize),
-					Vector3(-renderSize.x,-renderSize.y+_bevelSize,-renderSize.z+_bevelSize)
-					);
-
- 				// Right
-				addTriangle(Vector3(renderSize.x,renderSize.y-_bevelSize,renderSize.z-_bevelSize),
-					Vector3(renderSize.x,-renderSize.y+_bevelSize,renderSize.z-_bevelSize),
-					Vector3(renderSize.x,renderSize.y-_bevelSize,-renderSize.z+_bevelSize)
-					);
-				addTriangle(Vector3(renderSize.x,-renderSize.y+_bevelSize,-renderSize.z+_bevelSize),
-					Vector3(renderSize.x,renderSize.y-_bevelSize,-renderSize.z+_bevelSize),
-					Vector3(renderSize.x,-renderSize.y+_bevelSize,renderSize.z-_bevelSize)
-					);
-
-		drawBevels(); 
-
-		GLfloat mat_specular[] = { 0.4, 0.4, 0.4, 0.4 };
-		GLfloat low_shininess[] = { 100.0 };
-
-		glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
-		glMaterialfv(GL_FRONT, GL_SHININESS, low_shininess);
-
-		glVertexPointer(3, GL_FLOAT,6 * sizeof(GLfloat), &_vertices[0]);
-		glColorPointer(3, GL_FLOAT,6 * sizeof(GLfloat), &_vertices[3]);
-		glNormalPointer(GL_FLOAT,3 * sizeof(GLfloat), &_normals[0]);
-		glDrawElements(GL_TRIANGLES, _indices.size(), GL_UNSIGNED_SHORT, &_indices[0]);
-		_vertices.clear();
-		_indices.clear();
-		_normals.clear();
+		glVertexPointer(3, GL_FLOAT, 0, &mesh.vertices[0]);
+		glNormalPointer(GL_FLOAT, 0, &mesh.normals[0]);
+		glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_INT, &mesh.indices[0]);
 }
 
 
@@ -200,24 +18,35 @@ const float square_arr[] = {-0.125F,-0.125F,
 							-0.125F, 0.125F,
 							 0.125F, 0.125F,
 							 0.125F,-0.125F};
-void renderShape(const Enum::Shape::Value& shape, const Vector3& size, const Color3& ncolor)
+// Made once and kept, one with normals for lit shapes and one without
+static GLUquadric* getQuadric(bool normals)
+{
+	static GLUquadric* smooth = NULL;
+	static GLUquadric* flat = NULL;
+	if(smooth == NULL)
+	{
+		smooth = gluNewQuadric();
+		flat = gluNewQuadric();
+		gluQuadricNormals(flat, GLU_NONE);
+	}
+	return normals ? smooth : flat;
+}
+
+void renderShape(const Enum::Shape::Value& shape, const Vector3& size)
 {
-	color = ncolor;
 	switch(shape)
 	{
 		case Enum::Shape::Block:
 			renderBlock(size);
 			break;
 		case Enum::Shape::Ball:
-			glColor(ncolor);
 			glPushMatrix();
 			glScalef(size.x, size.y, size.z);
-			gluSphere(gluNewQuadric(), 1, 20, 20);
+			gluSphere(getQuadric(true), 1, 20, 20);
 			glPopMatrix();
 			break;
 		default:
-			GLUquadric * q = gluNewQuadric();
-			glColor(ncolor);
+			GLUquadric * q = getQuadric(true);
 			glPushMatrix();
 			glScalef(size.x, size.y, size.z);
 			glRotatef(90, 0, 1, 0);
@@ -229,9 +58,9 @@ void renderShape(const Enum::Shape::Value& shape, const Vector3& size, const Col
 			gluDisk(q, 0, 1, 12, 12);
 			glPopMatrix();
 			/*Plusses, can possibly integrate into cylinder code later on*/
+			glPushAttrib(GL_CURRENT_BIT);
 			glVertexPointer(2, GL_FLOAT,0, square_arr);
 			glPushMatrix();
-			glDisable(GL_COLOR_ARRAY);
 			glColor3f(127,127,127);
 			glRotatef(90,0,1,0);
 			glTranslatef(0,0,-(size.z+0.001F));
@@ -240,11 +69,9 @@ void renderShape(const Enum::Shape::Value& shape, const Vector3& size, const Col
 			glDrawArrays(GL_TRIANGLE_FAN, 0, 4); 
 			glScalef(1/(size.x*8),size.x*8,1);
 			glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-			glEnable(GL_COLOR_ARRAY);
 			glPopMatrix();
 
 			glPushMatrix();
-			glDisable(GL_COLOR_ARRAY);
 			glRotatef(-90,0,1,0);
 			glTranslatef(0,0,-(size.z+0.001F));
 			glScalef(0.75,0.75,0.75);
@@ -252,9 +79,8 @@ void renderShape(const Enum::Shape::Value& shape, const Vector3& size, const Col
 			glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 			glScalef(1/(size.x*8),size.x*8,1);
 			glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-			glEnable(GL_COLOR_ARRAY);
 			glPopMatrix();
-			
+			glPopAttrib();
 	}
 }
 
@@ -334,93 +160,7 @@ void translateFace(const char face, const Vector3& size)
     -0.5f, 0.25F, -0.5f      // Back-top-right
 };*/
 
-static const int BMP_FACES = 5*2;
-static const GLfloat bumpTriangles[] = {
-	//Top
-    -0.3F, 0.1F, -0.3F,
-	-0.3F, 0.1F, 0.3F,
-	0.3F, 0.1F, -0.3F,
-
-	0.3F, 0.1F, -0.3F,
-	-0.3F, 0.1F, 0.3F,
-	0.3F, 0.1F, 0.3F,
-
-
-	//Front
-	-0.3F, 0.1F, 0.3F,
-	-0.3F, -0.1F, 0.3F,
-	0.3F, 0.1F, 0.3F,
-	
-	0.3F, 0.1F, 0.3F,
-	-0.3F, -0.1F, 0.3F,
-	0.3F, -0.1F, 0.3F,
-
-
-	//Back
-	-0.3F, -0.1F, -0.3F,
-	-0.3F, 0.1F, -0.3F,
-	0.3F, -0.1F, -0.3F,
-	
-	0.3F, -0.1F, -0.3F,
-	-0.3F, 0.1F, -0.3F,
-	0.3F, 0.1F, -0.3F,
-
-
-	//Right
-	0.3F, -0.1F, -0.3F,
-	0.3F, 0.1F, -0.3F,
-	0.3F, -0.1F, 0.3F,
-	
-	0.3F, -0.1F, 0.3F,
-	0.3F, 0.1F, -0.3F,
-	0.3F, 0.1F, 0.3F,
-
-
-	//Left
-	-0.3F, 0.1F, -0.3F,
-	-0.3F, -0.1F, -0.3F,
-	-0.3F, 0.1F, 0.3F,
-	
-	-0.3F, 0.1F, 0.3F,
-	-0.3F, -0.1F, -0.3F,
-	-0.3F, -0.1F, 0.3F,
-};
-
-static const GLfloat bumpTriangleNormals[] = {
-	0.000000F, 1.000000F, 0.000000F,
-	0.000000F, 1.000000F, 0.000000F,
-	0.000000F, 1.000000F, 0.000000F,
-	0.000000F, 1.000000F, -0.000000F,
-	-0.000000F, 1.000000F, 0.000000F,
-	0.000000F, 1.000000F, 0.000000F,
-	-0.000000F, 0.000000F, 1.000000F,
-	0.000000F, 0.000000F, 1.000000F,
-	0.000000F, 0.000000F, 1.000000F,
-	0.000000F, 0.000000F, 1.000000F,
-	0.000000F, 0.000000F, 1.000000F,
-	0.000000F, -0.000000F, 1.000000F,
-	0.000000F, 0.000000F, -1.000000F,
-	0.000000F, 0.000000F, -1.000000F,
-	0.000000F, 0.000000F, -1.000000F,
-	0.000000F, 0.000000F, -1.000000F,
-	0.000000F, 0.000000F, -1.000000F,
-	-0.000000F, -0.000000F, -1.000000F,
-	1.000000F, 0.000000F, 0.000000F,
-	1.000000F, 0.000000F, 0.000000F,
-	1.000000F, 0.000000F, 0.000000F,
-	1.000000F, -0.000000F, 0.000000F,
-	1.000000F, 0.000000F, -0.000000F,
-	1.000000F, 0.000000F, 0.000000F,
-	-1.000000F, 0.000000F, 0.000000F,
-	-1.000000F, 0.000000F, 0.000000F,
-	-1.000000F, 0.000000F, -0.000000F,
-	-1.000000F, -0.000000F, 0.000000F,
-	-1.000000F, 0.000000F, 0.000000F,
-	-1.000000F, 0.000000F, 0.000000F,
-};
-
-
-void renderSurface(const char face, const Enum::SurfaceType::Value& surface, const Vector3& size, const Enum::Controller::Value& controller, const Color3& nColor)
+void renderSurface(const char face, const Enum::SurfaceType::Value& surface, const Vector3& size, const Enum::Controller::Value& controller)
 {
 	glPushMatrix();
 	translateFace(face, size);
@@ -428,10 +168,10 @@ void renderSurface(const char face, const Enum::SurfaceType::Value& surface, con
 	{
 	case Enum::SurfaceType::Motor:
 		{
+			glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT);
 			glDisable(GL_LIGHTING);
 			glColor(getControllerColor(controller));
-			GLUquadric * q = gluNewQuadric();
-			gluQuadricNormals(q, GLU_NONE);
+			GLUquadric * q = getQuadric(false);
 			glPushMatrix();
 			glTranslatef(0,0,-0.2F);
 			gluCylinder(q, 0.4F, 0.4F, 0.4F, 6, 1);
@@ -441,13 +181,14 @@ void renderSurface(const char face, const Enum::SurfaceType::Value& surface, con
 			glRotatef(180, 1, 0, 0);
 			gluDisk(q, 0, 0.4F, 6, 1);
 			glPopMatrix();
+			glPopAttrib();
 		}
 	case Enum::SurfaceType::Hinge:
 		{
+			glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT);
 			glDisable(GL_LIGHTING);
 			glColor3f(1,1,0);
-			GLUquadric * q = gluNewQuadric();
-			gluQuadricNormals(q, GLU_NONE);
+			GLUquadric * q = getQuadric(false);
 			glPushMatrix();	
 			glTranslatef(0,0,-0.5F);
 			gluCylinder(q, 0.2F, 0.2F, 1, 6, 1);
@@ -457,7 +198,7 @@ void renderSurface(const char face, const Enum::SurfaceType::Value& surface, con
 			glRotatef(180, 1, 0, 0);
 			gluDisk(q, 0, 0.2F, 6, 1);
 			glPopMatrix();
-			glEnable(GL_LIGHTING);
+			glPopAttrib();
 		}
 	break;
 	case Enum::SurfaceType::Bumps:
@@ -484,22 +225,15 @@ void renderSurface(const char face, const Enum::SurfaceType::Value& surface, con
 					break;
 			}
 			glTranslatef(-x/2+0.5F,0,-y/2+0.5F);
-			glColor(color);
-			glDisableClientState(GL_COLOR_ARRAY);
-			glVertexPointer(3, GL_FLOAT, 0, bumpTriangles);
-			glNormalPointer(GL_FLOAT, 0, bumpTriangleNormals);
-			for(float i = 0; i < y; i++)
+			// Every stud on the face in one array and one draw
+			BrickMesh studs;
+			BrickMeshBuilder::buildStuds((int)ceil(x), (int)ceil(y), CoordinateFrame(), studs);
+			if(!studs.vertices.empty())
 			{
-				glPushMatrix();
-				for(float j = 0; j < x; j++)
-				{
-					glDrawArrays(GL_TRIANGLES, 0, 30);
-					glTranslatef(1,0,0);
-				}
-				glPopMatrix();
-				glTranslatef(0,0,1);
+				glVertexPointer(3, GL_FLOAT, 0, &studs.vertices[0]);
+				glNormalPointer(GL_FLOAT, 0, &studs.normals[0]);
+				glDrawArrays(GL_TRIANGLES, 0, (GLsizei)studs.vertices.size());
 			}
-			glEnableClientState(GL_COLOR_ARRAY);
 		}
 	break;
 	default:
@@ -0,0 +1,257 @@
+#include "SelectionRenderer.h"
+#include "BrickMeshBuilder.h"
+
+SelectionRenderer::SelectionRenderer()
+{
+	builtVersion = -1;
+	builtHandles = NO_HANDLES;
+	buildCount = 0;
+	vertexCount = 0;
+}
+
+int SelectionRenderer::getBuildCount()
+{
+	return buildCount;
+}
+
+int SelectionRenderer::getVertexCount()
+{
+	return vertexCount;
+}
+
+void SelectionRenderer::buildUnitSphere()
+{
+	BrickMesh mesh;
+	BrickMeshBuilder::buildBall(Vector3(1, 1, 1), 16, 12, mesh);
+	for(size_t i = 0; i < mesh.indices.size(); i++)
+		unitSphere.append(mesh.vertices[mesh.indices[i]]);
+}
+
+void SelectionRenderer::addTriangle(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& normalA, const Vector3& normalB, const Vector3& normalC, const Color3& color)
+{
+	positions.append(a, b, c);
+	normals.append(normalA, normalB, normalC);
+	colors.append(color, color, color);
+}
+
+void SelectionRenderer::addBox(const CoordinateFrame& cFrame, const Vector3& corner0, const Vector3& corner1, const Color3& color)
+{
+	Box box = cFrame.toWorldSpace(Box(corner0, corner1));
+	for(int face = 0; face < 6; face++)
+	{
+		Vector3 v0, v1, v2, v3;
+		box.getFaceCorners(face, v0, v1, v2, v3);
+		Vector3 normal = (v1 - v0).cross(v3 - v0).direction();
+		addTriangle(v0, v1, v2, normal, normal, normal, color);
+		addTriangle(v0, v2, v3, normal, normal, normal, color);
+	}
+}
+
+void SelectionRenderer::addOutline(const CoordinateFrame& cFrame, const Vector3& half)
+{
+	// A bar along each edge, 0.1 thick. The upright bars cover the corners,
+	// the others stop inside them.
+	Color3 outline = Color3::cyan();
+	const float thickness = 0.05F;
+	const float signs[4][2] = {{1, 1}, {-1, 1}, {-1, -1}, {1, -1}};
+	for(int i = 0; i < 4; i++)
+	{
+		float a = signs[i][0];
+		float b = signs[i][1];
+		Vector3 x(0, a * half.y, b * half.z);
+		addBox(cFrame, x + Vector3(half.x - thickness, thickness, thickness), x - Vector3(half.x - thickness, thickness, thickness), outline);
+		Vector3 y(a * half.x, 0, b * half.z);
+		addBox(cFrame, y + Vector3(thickness, half.y + thickness, thickness), y - Vector3(thickness, half.y + thickness, thickness), outline);
+		Vector3 z(a * half.x, b * half.y, 0);
+		addBox(cFrame, z + Vector3(thickness, thickness, half.z - thickness), z - Vector3(thickness, thickness, half.z - thickness), outline);
+	}
+}
+
+void SelectionRenderer::addArrow(const Vector3& start, const Vector3& direction, const Color3& color)
+{
+	// The shape Draw::arrow gives, a 0.3 long cone on a shaft
+	const int sections = 12;
+	const float headRadius = 0.1F;
+	const float shaftRadius = 0.05F;
+	Vector3 tip = start + direction;
+	Vector3 u = direction.direction();
+	Vector3 v = u.x == 0 ? Vector3::unitX() : Vector3::unitY();
+	Vector3 w = u.cross(v).direction();
+	v = w.cross(u).direction();
+	Vector3 back = tip - u * 0.3F;
+	for(int i = 0; i < sections; i++)
+	{
+		float angle0 = (float)G3D::twoPi() * i / sections;
+		float angle1 = (float)G3D::twoPi() * (i + 1) / sections;
+		Vector3 dir0 = v * cos(angle0) + w * sin(angle0);
+		Vector3 dir1 = v * cos(angle1) + w * sin(angle1);
+		addTriangle(tip, back + dir0 * headRadius, back + dir1 * headRadius, dir0, dir0, dir1, color);
+		addTriangle(back, back + dir1 * headRadius, back + dir0 * headRadius, -u, -u, -u, color);
+		Vector3 a0 = start + dir0 * shaftRadius;
+		Vector3 a1 = start + dir1 * shaftRadius;
+		Vector3 b0 = back + dir0 * shaftRadius;
+		Vector3 b1 = back + dir1 * shaftRadius;
+		addTriangle(a0, a1, b0, dir0, dir1, dir0, color);
+		addTriangle(b0, a1, b1, dir0, dir1, dir1, color);
+	}
+}
+
+void SelectionRenderer::addSphere(const Vector3& center, float radius, const Color3& color)
+{
+	for(int i = 0; i < unitSphere.size(); i += 3)
+		addTriangle(center + unitSphere[i] * radius, center + unitSphere[i + 1] * radius, center + unitSphere[i + 2] * radius, unitSphere[i], unitSphere[i + 1], unitSphere[i + 2], color);
+}
+
+bool SelectionRenderer::isStale(int version, Handles handles, const Vector3& camera)
+{
+	if(version != builtVersion || handles != builtHandles)
+		return true;
+	if(handles == RESIZE_HANDLES && camera != builtCamera)
+		return true;
+	for(size_t i = 0; i < snapshots.size(); i++)
+	{
+		const Snapshot& snapshot = snapshots[i];
+		if(snapshot.part->getRenderCFrame() != snapshot.cFrame || snapshot.part->getSize() != snapshot.size)
+			return true;
+	}
+	return false;
+}
+
+void SelectionRenderer::build(const std::vector<Instance*>& selection, const Vector3& camera)
+{
+	buildCount++;
+	if(unitSphere.size() == 0)
+		buildUnitSphere();
+	snapshots.clear();
+	positions.fastClear();
+	normals.fastClear();
+	colors.fastClear();
+	for(size_t i = 0; i < selection.size(); i++)
+	{
+		PartInstance* part = dynamic_cast<PartInstance*>(selection[i]);
+		if(part == NULL)
+			continue;
+		Snapshot snapshot;
+		snapshot.part = part;
+		snapshot.cFrame = part->getRenderCFrame();
+		snapshot.size = part->getSize();
+		snapshots.push_back(snapshot);
+
+		const CoordinateFrame& c = snapshot.cFrame;
+		Vector3 half = snapshot.size / 2;
+		Vector3 pos = c.translation;
+		addOutline(c, half);
+		if(builtHandles == ARROW_HANDLES)
+		{
+			// Along the world axes, reaching 1.5 past the part's bounds
+			AABox box;
+			c.toWorldSpace(Box(-half, half)).getBounds(box);
+			Vector3 reach = box.high() - pos + Vector3(1.5F, 1.5F, 1.5F);
+			Color3 arrow = Color3::orange();
+			addArrow(pos, Vector3(0, reach.y, 0), arrow);
+			addArrow(pos, Vector3(0, -reach.y, 0), arrow);
+			addArrow(pos, Vector3(reach.x, 0, 0), arrow);
+			addArrow(pos, Vector3(-reach.x, 0, 0), arrow);
+			addArrow(pos, Vector3(0, 0, reach.z), arrow);
+			addArrow(pos, Vector3(0, 0, -reach.z), arrow);
+		}
+		else if(builtHandles == RESIZE_HANDLES)
+		{
+			// Off each face, growing with distance so they stay grabbable
+			float distance = (pos - camera).length();
+			if(distance < 200)
+			{
+				float radius = distance * 0.025F;
+				if(radius < 0.5F)
+					radius = 0.5F;
+				Vector3 offsets[3] = {c.lookVector() * (half.z + 2), c.rightVector() * (half.x + 2), c.upVector() * (half.y + 2)};
+				for(int axis = 0; axis < 3; axis++)
+				{
+					addSphere(pos + offsets[axis], radius, Color3::cyan());
+					addSphere(pos - offsets[axis], radius, Color3::cyan());
+				}
+			}
+		}
+	}
+
+	vertexCount = positions.size();
+	if(vertexCount == 0)
+		return;
+	size_t bytes = vertexCount * (sizeof(Vector3) * 2 + sizeof(Color3)) + 3 * 16 + 8;
+	if(varArea.isNull() || varArea->totalSize() < bytes)
+		varArea = VARArea::create(bytes + bytes / 2, VARArea::WRITE_ONCE);
+	else
+		varArea->reset();
+	vertexArray = VAR(positions, varArea);
+	normalArray = VAR(normals, varArea);
+	colorArray = VAR(colors, varArea);
+}
+
+void SelectionRenderer::render(RenderDevice* rd, const std::vector<Instance*>& selection, int version, Handles handles)
+{
+	Vector3 camera = rd->getCameraToWorldMatrix().translation;
+	if(isStale(version, handles, camera))
+	{
+		builtVersion = version;
+		builtHandles = handles;
+		builtCamera = camera;
+		build(selection, camera);
+	}
+	if(vertexCount == 0)
+		return;
+
+	rd->pushState();
+	rd->setObjectToWorldMatrix(CoordinateFrame());
+	rd->setShadeMode(RenderDevice::SHADE_SMOOTH);
+	rd->setCullFace(RenderDevice::CULL_BACK);
+	rd->beginIndexedPrimitives();
+	rd->setVertexArray(vertexArray);
+	rd->setNormalArray(normalArray);
+	rd->setColorArray(colorArray);
+	rd->sendSequentialIndices(RenderDevice::TRIANGLES, vertexCount);
+	rd->endIndexedPrimitives();
+	rd->popState();
+}
+
+void SelectionRenderer::renderMarkers(RenderDevice* rd, const Array<Sphere>& markers, const Color4& color)
+{
+	if(markers.size() == 0)
+		return;
+	if(unitSphere.size() == 0)
+		buildUnitSphere();
+	markerPositions.fastClear();
+	markerNormals.fastClear();
+	for(int i = 0; i < markers.size(); i++)
+	{
+		for(int j = 0; j < unitSphere.size(); j++)
+		{
+			markerPositions.append(markers[i].center + unitSphere[j] * markers[i].radius);
+			markerNormals.append(unitSphere[j]);
+		}
+	}
+	size_t bytes = markerPositions.size() * sizeof(Vector3) * 2 + 2 * 16 + 8;
+	if(markerArea.isNull() || markerArea->totalSize() < bytes)
+		markerArea = VARArea::create(bytes + bytes / 2, VARArea::WRITE_EVERY_FRAME);
+	else
+		markerArea->reset();
+	VAR vertices(markerPositions, markerArea);
+	VAR normals(markerNormals, markerArea);
+
+	// Back faces first then front, the way Draw::sphere blends them
+	rd->pushState();
+	rd->setObjectToWorldMatrix(CoordinateFrame());
+	rd->setShadeMode(RenderDevice::SHADE_SMOOTH);
+	rd->setBlendFunc(RenderDevice::BLEND_SRC_ALPHA, RenderDevice::BLEND_ONE_MINUS_SRC_ALPHA);
+	rd->disableDepthWrite();
+	rd->setColor(color);
+	rd->beginIndexedPrimitives();
+	glDisableClientState(GL_COLOR_ARRAY);
+	rd->setVertexArray(vertices);
+	rd->setNormalArray(normals);
+	rd->setCullFace(RenderDevice::CULL_FRONT);
+	rd->sendSequentialIndices(RenderDevice::TRIANGLES, markerPositions.size());
+	rd->setCullFace(RenderDevice::CULL_BACK);
+	rd->sendSequentialIndices(RenderDevice::TRIANGLES, markerPositions.size());
+	rd->endIndexedPrimitives();
+	rd->popState();
+}